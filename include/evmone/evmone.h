@@ -14,6 +14,37 @@ extern "C" {
 
 EVMC_EXPORT struct evmc_vm* evmc_create_evmone(void) EVMC_NOEXCEPT;
 
+/**
+ * The opcode counts of the code executed in the given revision,
+ * collected by the "histogram_collect" VM option.
+ */
+struct evmone_histogram_entry
+{
+    /** The revision of the executions. */
+    enum evmc_revision rev;
+
+    /** The Keccak-256 hash of the executed code. */
+    evmc_bytes32 code_hash;
+
+    /** The number of the executed instructions, indexed by opcode. */
+    uint64_t counts[256];
+};
+
+/**
+ * Takes the snapshot of the opcode histogram aggregated across all VM instances and threads.
+ *
+ * @param entries      The array for the entries. May be null if max_entries is 0.
+ * @param max_entries  The capacity of the entries array.
+ * @return             The number of all entries in the histogram. Only the first max_entries of
+ *                     them are copied, so the snapshot is complete if this does not exceed
+ *                     max_entries. Returns 0 if the memory for the snapshot cannot be allocated.
+ */
+EVMC_EXPORT size_t evmone_histogram_snapshot(
+    struct evmone_histogram_entry* entries, size_t max_entries) EVMC_NOEXCEPT;
+
+/** Resets the opcode histogram counts to zero. */
+EVMC_EXPORT void evmone_histogram_reset(void) EVMC_NOEXCEPT;
+
 #if __cplusplus
 }
 #endif
@@ -3,8 +3,13 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "advanced_analysis.hpp"
+#include "baseline_instruction_table.hpp"
+#include "eof.hpp"
+#include "instructions.hpp"
 #include "opcodes_helpers.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 namespace evmone::advanced
 {
@@ -24,11 +29,11 @@ struct BlockAnalysis
     int stack_max_growth = 0;
     int stack_change = 0;
 
-    /// The index of the beginblock instruction that starts the block.
+    /// The index of the block in AdvancedCodeAnalysis::blocks.
     /// This is the place where the analysis data is going to be dumped.
-    size_t begin_block_index = 0;
+    uint32_t index = 0;
 
-    explicit BlockAnalysis(size_t index) noexcept : begin_block_index{index} {}
+    explicit BlockAnalysis(uint32_t block_index) noexcept : index{block_index} {}
 
     /// Close the current block by producing compressed information about the block.
     [[nodiscard]] BlockInfo close() const noexcept
@@ -39,23 +44,434 @@ struct BlockAnalysis
     }
 };
 
-AdvancedCodeAnalysis analyze(evmc_revision rev, bytes_view code) noexcept
+namespace
 {
-    const auto& op_tbl = get_op_table(rev);
-    const auto opx_beginblock_fn = op_tbl[OPX_BEGINBLOCK].fn;
+/// Checks if the instruction terminates the basic block and the code following it
+/// is unreachable till the next JUMPDEST.
+constexpr bool is_terminator(uint8_t opcode) noexcept
+{
+    return opcode == OP_JUMP || opcode == OP_STOP || opcode == OP_RETURN || opcode == OP_REVERT ||
+           opcode == OP_SELFDESTRUCT;
+}
 
-    AdvancedCodeAnalysis analysis;
+/// Checks if the instruction needs the base gas cost of the preceding instructions
+/// in the block to compute the exact "gas left" value.
+constexpr bool needs_partial_block_cost(uint8_t opcode) noexcept
+{
+    switch (opcode)
+    {
+    case OP_GAS:
+    case OP_CALL:
+    case OP_CALLCODE:
+    case OP_DELEGATECALL:
+    case OP_STATICCALL:
+    case OP_CREATE:
+    case OP_CREATE2:
+    case OP_SSTORE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// Returns the number of PUSH data bytes present in the code (may be truncated at the code end).
+inline size_t push_data_size(
+    uint8_t opcode, const uint8_t* code_pos, const uint8_t* code_end) noexcept
+{
+    const auto push_size = static_cast<size_t>(opcode - OP_PUSH1) + 1;
+    return std::min(push_size, static_cast<size_t>(code_end - code_pos));
+}
+
+/// Skips dead block instructions till next JUMPDEST or code end.
+inline const uint8_t* skip_dead_code(const uint8_t* code_pos, const uint8_t* code_end) noexcept
+{
+    while (code_pos != code_end && *code_pos != OP_JUMPDEST)
+    {
+        const auto opcode = *code_pos++;
+        if (opcode >= OP_PUSH1 && opcode <= OP_PUSH32)
+            code_pos += push_data_size(opcode, code_pos, code_end);
+    }
+    return code_pos;
+}
+
+/// Checks if the instruction is defined in the given EVM revision.
+inline bool is_defined(evmc_revision rev, uint8_t opcode) noexcept
+{
+    return instr::gas_costs[rev][opcode] != instr::undefined;
+}
+
+/// Returns the value pushed by the instruction or std::nullopt if it is not a PUSH.
+std::optional<uint256> get_push_value(
+    const AdvancedCodeAnalysis& analysis, Instruction instr, evmc_revision rev) noexcept
+{
+    const auto opcode = instr.opcode();
+    if (opcode == OP_PUSH0 && is_defined(rev, OP_PUSH0))
+        return 0;
+    if (opcode >= OP_PUSH1 && opcode <= OP_PUSH_INLINE_MAX)
+        return instr.arg();
+    if (opcode > OP_PUSH_INLINE_MAX && opcode <= OP_PUSH32)
+        return analysis.push_values[instr.arg()];
+    return std::nullopt;
+}
+
+/// Removes the last instruction together with its push value.
+inline void pop_instr(AdvancedCodeAnalysis& analysis) noexcept
+{
+    const auto opcode = analysis.instrs.back().opcode();
+    if (opcode > OP_PUSH_INLINE_MAX && opcode <= OP_PUSH32)
+        analysis.push_values.pop_back();
+    analysis.instrs.pop_back();
+}
+
+/// Appends the PUSH instruction of the given value.
+void push_constant(AdvancedCodeAnalysis& analysis, const uint256& value) noexcept
+{
+    if (value <= Instruction::max_arg)
+    {
+        const auto v = static_cast<uint32_t>(value);
+        const auto opcode = v <= 0xff ? OP_PUSH1 : v <= 0xffff ? OP_PUSH2 : OP_PUSH3;
+        analysis.instrs.emplace_back(opcode, v);
+    }
+    else
+    {
+        analysis.instrs.emplace_back(OP_PUSH32, static_cast<uint32_t>(analysis.push_values.size()));
+        analysis.push_values.emplace_back(value);
+    }
+}
+
+/// Evaluates the instruction if it is a pure function of its stack arguments.
+/// The implementation of the interpreters is used so the folded value is always identical.
+///
+/// @return  False if the instruction cannot be evaluated in the analysis phase.
+bool evaluate(uint8_t opcode, StackTop stack) noexcept
+{
+    switch (opcode)
+    {
+#define ON_FOLDABLE_OPCODE(OPCODE)        \
+    case OPCODE:                          \
+        instr::core::impl<OPCODE>(stack); \
+        return true;
+
+        ON_FOLDABLE_OPCODE(OP_ADD)
+        ON_FOLDABLE_OPCODE(OP_MUL)
+        ON_FOLDABLE_OPCODE(OP_SUB)
+        ON_FOLDABLE_OPCODE(OP_DIV)
+        ON_FOLDABLE_OPCODE(OP_SDIV)
+        ON_FOLDABLE_OPCODE(OP_MOD)
+        ON_FOLDABLE_OPCODE(OP_SMOD)
+        ON_FOLDABLE_OPCODE(OP_ADDMOD)
+        ON_FOLDABLE_OPCODE(OP_MULMOD)
+        ON_FOLDABLE_OPCODE(OP_SIGNEXTEND)
+        ON_FOLDABLE_OPCODE(OP_LT)
+        ON_FOLDABLE_OPCODE(OP_GT)
+        ON_FOLDABLE_OPCODE(OP_SLT)
+        ON_FOLDABLE_OPCODE(OP_SGT)
+        ON_FOLDABLE_OPCODE(OP_EQ)
+        ON_FOLDABLE_OPCODE(OP_ISZERO)
+        ON_FOLDABLE_OPCODE(OP_AND)
+        ON_FOLDABLE_OPCODE(OP_OR)
+        ON_FOLDABLE_OPCODE(OP_XOR)
+        ON_FOLDABLE_OPCODE(OP_NOT)
+        ON_FOLDABLE_OPCODE(OP_BYTE)
+        ON_FOLDABLE_OPCODE(OP_SHL)
+        ON_FOLDABLE_OPCODE(OP_SHR)
+        ON_FOLDABLE_OPCODE(OP_SAR)
+#undef ON_FOLDABLE_OPCODE
+
+    default:
+        return false;
+    }
+}
+
+/// Folds the instruction with the constant arguments pushed by the preceding instructions
+/// of the current block into a single PUSH.
+bool fold_constants(
+    AdvancedCodeAnalysis& analysis, size_t block_begin, evmc_revision rev, uint8_t opcode) noexcept
+{
+    const auto num_args = static_cast<size_t>(instr::traits[opcode].stack_height_required);
+    if (num_args == 0 || analysis.instrs.size() - block_begin < num_args)
+        return false;
+
+    uint256 args[3];
+    assert(num_args <= std::size(args));
+    const auto first_arg = analysis.instrs.size() - num_args;
+    bool has_push_value_slot = false;
+    for (size_t i = 0; i < num_args; ++i)
+    {
+        const auto instr = analysis.instrs[first_arg + i];
+        const auto value = get_push_value(analysis, instr, rev);
+        if (!value.has_value())
+            return false;
+        args[i] = *value;
+        if (instr.opcode() > OP_PUSH_INLINE_MAX)
+            has_push_value_slot = true;
+    }
+
+    // The top stack item is the last argument and the result replaces the deepest one.
+    if (!evaluate(opcode, &args[num_args - 1]))
+        return false;
+
+    // Do not grow the push_values beyond the size computed by the first analysis pass.
+    if (args[0] > Instruction::max_arg && !has_push_value_slot)
+        return false;
+
+    for (size_t i = 0; i < num_args; ++i)
+        pop_instr(analysis);
+    push_constant(analysis, args[0]);
+    return true;
+}
+
+/// Applies the peephole optimizations to the instruction about to be appended
+/// to the current block starting at the block_begin instruction index.
+///
+/// @return  True if the instruction has been handled and must not be appended.
+bool optimize(AdvancedCodeAnalysis& analysis, size_t block_begin, evmc_revision rev,
+    uint8_t opcode, size_t code_size) noexcept
+{
+    if (!is_defined(rev, opcode))
+        return false;
+
+    if (analysis.instrs.size() == block_begin)
+        return false;
+    const auto prev = analysis.instrs.back();
+
+    if (opcode == OP_POP && prev.opcode() >= OP_DUP1 && prev.opcode() <= OP_DUP16)
+    {
+        analysis.instrs.pop_back();
+        return true;
+    }
+
+    if (opcode >= OP_SWAP1 && opcode <= OP_SWAP16 && prev.opcode() == opcode)
+    {
+        analysis.instrs.pop_back();
+        return true;
+    }
+
+    if (opcode == OP_JUMP)
+    {
+        const auto dst = get_push_value(analysis, prev, rev);
+        if (!dst.has_value())
+            return false;
+        pop_instr(analysis);
+        // The destination is resolved to the target instruction after all JUMPDESTs are known.
+        const auto arg = *dst < code_size ? static_cast<uint32_t>(*dst) : Instruction::max_arg;
+        analysis.instrs.emplace_back(OPX_JUMP_DIRECT, arg);
+        return true;
+    }
+
+    return fold_constants(analysis, block_begin, rev, opcode);
+}
+
+/// Replaces the code offsets in the OPX_JUMP_DIRECT instructions with the indexes
+/// of the target instructions.
+void resolve_direct_jumps(AdvancedCodeAnalysis& analysis) noexcept
+{
+    for (auto& instr : analysis.instrs)
+    {
+        if (instr.opcode() != OPX_JUMP_DIRECT)
+            continue;
+        const auto target = find_jumpdest(analysis, static_cast<int>(instr.arg()));
+        instr = Instruction{OPX_JUMP_DIRECT,
+            target >= 0 ? static_cast<uint32_t>(target) : Instruction::max_arg};
+    }
+}
 
-    const auto max_instrs_size = code.size() + 2;  // Additional OPX_BEGINBLOCK and STOP
-    analysis.instrs.reserve(max_instrs_size);
+/// Checks if the instruction is supported by the Advanced interpreter in the code
+/// of the given EOF version (0 means legacy code).
+inline bool is_supported(
+    const baseline::CostTable& cost_table, uint8_t eof_version, uint8_t opcode) noexcept
+{
+    if (cost_table[opcode] == instr::undefined)
+        return false;
 
-    // This is 2x more than needed but using (code.size() / 2 + 1) increases page-faults 1000x.
-    const auto max_args_storage_size = code.size() + 1;
-    analysis.push_values.reserve(max_args_storage_size);
+    // The immediate arguments of the legacy DUPN and SWAPN are not excluded
+    // from the legacy jump destinations so these instructions are not supported there.
+    return eof_version != 0 || (opcode != OP_DUPN && opcode != OP_SWAPN);
+}
+
+/// Returns the size of the immediate argument of the EOF instruction.
+inline size_t immediate_size(uint8_t opcode, const uint8_t* code_pos) noexcept
+{
+    if (opcode == OP_RJUMPV)
+        return 1 + size_t{*code_pos} * sizeof(int16_t);
+    return instr::traits[opcode].immediate_size;
+}
+
+/// Returns the code offset of the relative jump destination.
+inline size_t rjump_target(size_t pc_post, int16_t rel_offset) noexcept
+{
+    return static_cast<size_t>(static_cast<ptrdiff_t>(pc_post) + rel_offset);
+}
+
+/// Marks the code offsets being the relative jump destinations in the valid EOF code section.
+std::vector<bool> find_rjump_targets(bytes_view code) noexcept
+{
+    std::vector<bool> targets(code.size());
+    const auto code_begin = code.data();
+    const auto code_end = code_begin + code.size();
+    auto code_pos = code_begin;
+    while (code_pos != code_end)
+    {
+        const auto opcode = *code_pos++;
+        const auto imm = code_pos;
+        code_pos += immediate_size(opcode, imm);
+        const auto pc_post = static_cast<size_t>(code_pos - code_begin);
+
+        if (opcode == OP_RJUMP || opcode == OP_RJUMPI)
+            targets[rjump_target(pc_post, read_int16_be(imm))] = true;
+        else if (opcode == OP_RJUMPV)
+        {
+            for (size_t i = 0; i < imm[0]; ++i)
+                targets[rjump_target(pc_post, read_int16_be(&imm[1 + i * sizeof(int16_t)]))] =
+                    true;
+        }
+    }
+    return targets;
+}
+
+/// The sizes of the AdvancedCodeAnalysis buffers before the optimizations.
+struct AnalysisSizes
+{
+    size_t num_instrs = 1;  ///< Includes the final STOP.
+    size_t num_blocks = 0;
+    size_t num_push_values = 0;
+    size_t num_partial_block_costs = 0;
+    size_t num_jumpdests = 0;
+    size_t num_jump_table_entries = 0;
+};
+
+/// The first analysis pass adding the sizes of the analysis buffers needed by the code.
+/// This must follow the instruction selection of analyze_code(). The sizes are exact
+/// for legacy code without optimizations and undefined instructions, otherwise
+/// they are upper bounds.
+void compute_sizes(AnalysisSizes& sizes, bytes_view code, bool eof) noexcept
+{
+    // The code starts with the BEGINBLOCK.
+    ++sizes.num_instrs;
+    ++sizes.num_blocks;
+
+    const auto code_end = code.data() + code.size();
+    auto code_pos = code.data();
+    while (code_pos != code_end)
+    {
+        const auto opcode = *code_pos++;
+        ++sizes.num_instrs;
+
+        if (eof)
+        {
+            // Any instruction may start the block of the relative jump destination.
+            ++sizes.num_instrs;
+            ++sizes.num_blocks;
+
+            if (opcode == OP_RJUMPI || opcode == OP_RJUMPV || opcode == OP_CALLF)
+            {
+                // The follow-by block.
+                ++sizes.num_instrs;
+                ++sizes.num_blocks;
+            }
+            if (opcode == OP_RJUMPV)
+                sizes.num_jump_table_entries += 1 + size_t{*code_pos};
+        }
+
+        if (opcode == OP_JUMPDEST)
+        {
+            ++sizes.num_blocks;
+            if (!eof)
+                ++sizes.num_jumpdests;
+        }
+        else if (opcode == OP_JUMPI)
+            ++sizes.num_blocks;
+        else if (opcode >= OP_PUSH1 && opcode <= OP_PUSH32)
+        {
+            if (opcode > OP_PUSH_INLINE_MAX)
+                ++sizes.num_push_values;
+            code_pos += push_data_size(opcode, code_pos, code_end);
+        }
+        else if (needs_partial_block_cost(opcode))
+            ++sizes.num_partial_block_costs;
+        else if (eof)
+            code_pos += immediate_size(opcode, code_pos);
+        else if (is_terminator(opcode))
+            code_pos = skip_dead_code(code_pos, code_end);
+    }
+}
+
+/// Reserves the analysis buffers of the sizes computed by the first pass.
+void reserve_buffers(AdvancedCodeAnalysis& analysis, const AnalysisSizes& sizes) noexcept
+{
+    analysis.instrs.reserve(sizes.num_instrs);
+    analysis.blocks.resize(sizes.num_blocks);
+    analysis.push_values.reserve(sizes.num_push_values);
+    analysis.partial_block_costs.reserve(sizes.num_partial_block_costs);
+    analysis.jumpdest_offsets.reserve(sizes.num_jumpdests);
+    analysis.jumpdest_targets.reserve(sizes.num_jumpdests);
+    analysis.jump_tables.reserve(sizes.num_jump_table_entries);
+}
+
+/// Terminates the instructions and trims the blocks to the number of blocks used.
+void finalize(AdvancedCodeAnalysis& analysis, [[maybe_unused]] const AnalysisSizes& sizes,
+    size_t num_blocks) noexcept
+{
+    // Make sure the last block is terminated.
+    // TODO: This is not needed if the last instruction is a terminating one.
+    analysis.instrs.emplace_back(OP_STOP);
+
+    // Make sure the buffers have been sized by the first pass.
+    assert(analysis.instrs.size() <= sizes.num_instrs);
+    assert(num_blocks <= sizes.num_blocks);
+    assert(analysis.push_values.size() <= sizes.num_push_values);
+    assert(analysis.partial_block_costs.size() <= sizes.num_partial_block_costs);
+    assert(analysis.jumpdest_offsets.size() <= sizes.num_jumpdests);
+    assert(analysis.jump_tables.size() <= sizes.num_jump_table_entries);
+
+    analysis.blocks.resize(num_blocks);
+}
+
+/// Appends the analysis of the legacy code or of the valid EOF code section.
+///
+/// @param eof          The header of the EOF container or null for legacy code.
+/// @param container    The EOF container the header has been read from.
+/// @param block_index  The index of the first block of the code.
+/// @return             The index of the last block of the code.
+uint32_t analyze_code(AdvancedCodeAnalysis& analysis, evmc_revision rev, bytes_view code,
+    const EOF1Header* eof, bytes_view container, uint32_t block_index) noexcept
+{
+    const auto& op_tbl = get_op_table(rev);
+    const auto eof_version = eof != nullptr ? eof->version : uint8_t{0};
+    const auto& cost_table = baseline::get_baseline_cost_table(rev, eof_version);
+
+    // The relative jump destinations and the indexes of the instructions they are mapped to.
+    std::vector<bool> rjump_targets;
+    std::vector<uint32_t> target_instrs;
+    if (eof != nullptr)
+    {
+        rjump_targets = find_rjump_targets(code);
+        target_instrs.resize(code.size());
+    }
+    const auto first_instr = analysis.instrs.size();
+    const auto first_jump_table = analysis.jump_tables.size();
 
     // Create first block.
-    analysis.instrs.emplace_back(opx_beginblock_fn);
-    auto block = BlockAnalysis{0};
+    analysis.instrs.emplace_back(OPX_BEGINBLOCK, block_index);
+    auto block = BlockAnalysis{block_index};
+    // The index of the first instruction of the current block the optimizations may touch.
+    auto block_begin = analysis.instrs.size();
+    // No code instruction has been added to the current block yet.
+    auto block_empty = true;
+
+    // Saves the current block and creates new one.
+    const auto new_block = [&analysis, &block]() noexcept {
+        analysis.blocks[block.index] = block.close();
+        block = BlockAnalysis{block.index + 1};
+    };
+
+    // Creates new block starting with the injected BEGINBLOCK.
+    const auto inject_beginblock = [&]() noexcept {
+        new_block();
+        analysis.instrs.emplace_back(OPX_BEGINBLOCK, block.index);
+        block_begin = analysis.instrs.size();
+        block_empty = true;
+    };
 
     // TODO: Iterators are not used here because because push_end may point way outside of code
     //       and this is not allowed and MSVC will detect it with instrumented iterators.
@@ -64,36 +480,61 @@ AdvancedCodeAnalysis analyze(evmc_revision rev, bytes_view code) noexcept
     auto code_pos = code_begin;
     while (code_pos != code_end)
     {
-        const auto opcode = *code_pos++;
+        const auto offset = static_cast<size_t>(code_pos - code_begin);
+        const auto raw_opcode = *code_pos++;
+        const auto opcode = is_supported(cost_table, eof_version, raw_opcode) ?
+                                raw_opcode :
+                                static_cast<uint8_t>(OPX_UNDEFINED);
         const auto& opcode_info = op_tbl[opcode];
 
+        if (eof != nullptr && rjump_targets[offset])
+        {
+            // The relative jump destination must start a block. The JUMPDEST does it anyway.
+            if (opcode != OP_JUMPDEST && !block_empty)
+                inject_beginblock();
+            target_instrs[offset] = static_cast<uint32_t>(
+                opcode == OP_JUMPDEST ? analysis.instrs.size() : block_begin - 1);
+        }
+
         if (opcode == OP_JUMPDEST)
         {
-            // Save current block.
-            analysis.instrs[block.begin_block_index].arg.block = block.close();
-            // Create new block.
-            block = BlockAnalysis{analysis.instrs.size()};
+            new_block();
 
             // The JUMPDEST is always the first instruction in the block.
-            analysis.jumpdest_offsets.emplace_back(static_cast<int32_t>(code_pos - code_begin - 1));
-            analysis.jumpdest_targets.emplace_back(static_cast<int32_t>(analysis.instrs.size()));
+            if (eof == nullptr)
+            {
+                analysis.jumpdest_offsets.emplace_back(static_cast<int32_t>(offset));
+                analysis.jumpdest_targets.emplace_back(
+                    static_cast<int32_t>(analysis.instrs.size()));
+            }
         }
 
-        analysis.instrs.emplace_back(opcode_info.fn);
+        int stack_req = opcode_info.stack_req;
+        int stack_change = opcode_info.stack_change;
+        if (opcode == OP_CALLF)
+        {
+            // The stack effect of the CALLF is defined by the type of the called section.
+            const auto type = eof->get_type(container, read_uint16_be(code_pos));
+            stack_req = type.inputs;
+            stack_change = type.outputs - type.inputs;
+        }
 
-        block.stack_req = std::max(block.stack_req, opcode_info.stack_req - block.stack_change);
-        block.stack_change += opcode_info.stack_change;
+        block.stack_req = std::max(block.stack_req, stack_req - block.stack_change);
+        block.stack_change += stack_change;
         block.stack_max_growth = std::max(block.stack_max_growth, block.stack_change);
 
         block.gas_cost += opcode_info.gas_cost;
 
-        auto& instr = analysis.instrs.back();
-
+        uint32_t arg = 0;
         switch (opcode)
         {
         default:
             break;
 
+        case OP_JUMPDEST:
+            arg = block.index;
+            break;
+
         case OP_JUMP:
         case OP_STOP:
         case OP_RETURN:
@@ -101,66 +542,48 @@ AdvancedCodeAnalysis analyze(evmc_revision rev, bytes_view code) noexcept
         case OP_SELFDESTRUCT:
             // Skip dead block instructions till next JUMPDEST or code end.
             // Current instruction will be final one in the block.
-            while (code_pos != code_end && *code_pos != OP_JUMPDEST)
-            {
-                if (*code_pos >= OP_PUSH1 && *code_pos <= OP_PUSH32)
-                {
-                    const auto push_size = static_cast<size_t>(*code_pos - OP_PUSH1) + 1;
-                    code_pos = std::min(code_pos + push_size + 1, code_end);
-                }
-                else
-                    ++code_pos;
-            }
+            // The valid EOF code has no dead code but the JUMPDEST is not a jump destination.
+            if (eof == nullptr)
+                code_pos = skip_dead_code(code_pos, code_end);
             break;
 
         case OP_JUMPI:
             // JUMPI will be final instruction in the current block
             // and hold metadata for the next block.
-
-            // Save current block.
-            analysis.instrs[block.begin_block_index].arg.block = block.close();
-            // Create new block.
-            block = BlockAnalysis{analysis.instrs.size() - 1};
+            new_block();
+            arg = block.index;
             break;
 
         case ANY_SMALL_PUSH:
         {
             const auto push_size = static_cast<size_t>(opcode - OP_PUSH1) + 1;
-            const auto push_end = std::min(code_pos + push_size, code_end);
+            const auto push_end = code_pos + push_data_size(opcode, code_pos, code_end);
 
-            uint64_t value = 0;
             auto insert_bit_pos = (push_size - 1) * 8;
             while (code_pos < push_end)
             {
-                value |= uint64_t{*code_pos++} << insert_bit_pos;
+                arg |= uint32_t{*code_pos++} << insert_bit_pos;
                 insert_bit_pos -= 8;
             }
-            instr.arg.small_push_value = value;
             break;
         }
 
         case ANY_LARGE_PUSH:
         {
             const auto push_size = static_cast<size_t>(opcode - OP_PUSH1) + 1;
-            const auto push_end = code_pos + push_size;
+            const auto push_end = code_pos + push_data_size(opcode, code_pos, code_end);
 
+            arg = static_cast<uint32_t>(analysis.push_values.size());
             auto& push_value = analysis.push_values.emplace_back();
             const auto push_value_bytes = intx::as_bytes(push_value);
             auto insert_pos = &push_value_bytes[push_size - 1];
 
             // Copy bytes to the deticated storage in the order to match native endianness.
-            // The condition `code_pos < code_end` is to handle the edge case of PUSH being at
+            // The push_end is limited to the code end to handle the edge case of PUSH being at
             // the end of the code with incomplete value bytes.
-            // This condition can be replaced with single `push_end <= code_end` done once before
-            // the loop. Then the push value will stay 0 but the value is not reachable
-            // during the execution anyway.
-            // This seems like a good micro-optimization but we were not able to show
-            // this is faster, at least with GCC 8 (producing the best results at the time).
             // FIXME: Add support for big endian architectures.
-            while (code_pos < push_end && code_pos < code_end)
+            while (code_pos < push_end)
                 *insert_pos-- = *code_pos++;
-
-            instr.arg.push_value = &push_value;
             break;
         }
 
@@ -172,27 +595,419 @@ AdvancedCodeAnalysis analyze(evmc_revision rev, bytes_view code) noexcept
         case OP_CREATE:
         case OP_CREATE2:
         case OP_SSTORE:
-            instr.arg.number = block.gas_cost;
+            arg = static_cast<uint32_t>(analysis.partial_block_costs.size());
+            analysis.partial_block_costs.emplace_back(
+                clamp<decltype(BlockInfo{}.gas_cost)>(block.gas_cost));
             break;
 
         case OP_PC:
-            instr.arg.number = code_pos - code_begin - 1;
+            arg = static_cast<uint32_t>(offset);
+            break;
+
+        case OP_RJUMP:
+        case OP_RJUMPI:
+            // The code offset is replaced with the target instruction index at the end.
+            arg = static_cast<uint32_t>(rjump_target(offset + 3, read_int16_be(code_pos)));
+            code_pos += sizeof(int16_t);
+            break;
+
+        case OP_RJUMPV:
+        {
+            const size_t count = *code_pos++;
+            const auto pc_post = offset + 2 + count * sizeof(int16_t);
+            arg = static_cast<uint32_t>(analysis.jump_tables.size());
+            analysis.jump_tables.emplace_back(static_cast<uint32_t>(count));
+            for (size_t i = 0; i < count; ++i)
+            {
+                analysis.jump_tables.emplace_back(
+                    static_cast<uint32_t>(rjump_target(pc_post, read_int16_be(code_pos))));
+                code_pos += sizeof(int16_t);
+            }
+            break;
+        }
+
+        case OP_CALLF:
+            arg = read_uint16_be(code_pos);
+            code_pos += sizeof(uint16_t);
+            break;
+
+        case OP_DUPN:
+        case OP_SWAPN:
+            arg = *code_pos++;
             break;
         }
+
+        if (!optimize(analysis, block_begin, rev, opcode, code.size()))
+            analysis.instrs.emplace_back(opcode, arg);
+        block_empty = false;
+
+        if (opcode == OP_JUMPDEST || opcode == OP_JUMPI)
+            block_begin = analysis.instrs.size();
+        else if (opcode == OP_RJUMPI || opcode == OP_RJUMPV || opcode == OP_CALLF)
+            inject_beginblock();  // The follow-by block, also the CALLF return address.
     }
 
     // Save current block.
-    analysis.instrs[block.begin_block_index].arg.block = block.close();
+    analysis.blocks[block.index] = block.close();
 
-    // Make sure the last block is terminated.
-    // TODO: This is not needed if the last instruction is a terminating one.
-    analysis.instrs.emplace_back(op_tbl[OP_STOP].fn);
+    if (eof != nullptr)
+    {
+        // Replace the code offsets of the relative jump destinations with the instruction indexes.
+        for (auto i = first_instr; i < analysis.instrs.size(); ++i)
+        {
+            auto& instr = analysis.instrs[i];
+            if (instr.opcode() == OP_RJUMP || instr.opcode() == OP_RJUMPI)
+                instr = Instruction{instr.opcode(), target_instrs[instr.arg()]};
+        }
+        for (auto pos = first_jump_table; pos < analysis.jump_tables.size();)
+        {
+            const auto count = analysis.jump_tables[pos++];
+            for (const auto end = pos + count; pos < end; ++pos)
+                analysis.jump_tables[pos] = target_instrs[analysis.jump_tables[pos]];
+        }
+    }
+
+    return block.index;
+}
+}  // namespace
+
+AdvancedCodeAnalysis analyze(evmc_revision rev, bytes_view code) noexcept
+{
+    assert(code.size() <= max_code_size);
+
+    AnalysisSizes sizes;
+    compute_sizes(sizes, code, false);
+
+    AdvancedCodeAnalysis analysis;
+    reserve_buffers(analysis, sizes);
+    const auto last_block = analyze_code(analysis, rev, code, nullptr, {}, 0);
+    finalize(analysis, sizes, size_t{last_block} + 1);
+
+    build_jumpdest_index(analysis);
+    resolve_direct_jumps(analysis);
+    return analysis;
+}
+
+AdvancedCodeAnalysis analyze_eof1(evmc_revision rev, bytes_view container) noexcept
+{
+    assert(container.size() <= max_eof_container_size);
+
+    const auto header = read_valid_eof1_header(container);
+    const auto num_sections = size_t{header.num_code_sections};
+
+    // The code sections are adjacent, so the section code is the next get_code_size() bytes.
+    const auto code_sections = header.get_code_sections(container);
+
+    AnalysisSizes sizes;
+    for (size_t i = 0, code_pos = 0; i < num_sections; ++i)
+    {
+        const auto code = code_sections.substr(code_pos, header.get_code_size(container, i));
+        code_pos += code.size();
+        compute_sizes(sizes, code, true);
+    }
+
+    AdvancedCodeAnalysis analysis;
+    reserve_buffers(analysis, sizes);
+    analysis.code_sections.reserve(num_sections);
+    uint32_t num_blocks = 0;
+    for (size_t i = 0, code_pos = 0; i < num_sections; ++i)
+    {
+        analysis.code_sections.push_back({static_cast<uint32_t>(analysis.instrs.size()),
+            uint32_t{header.get_type(container, i).max_stack_height}});
+        const auto code = code_sections.substr(code_pos, header.get_code_size(container, i));
+        code_pos += code.size();
+        num_blocks = analyze_code(analysis, rev, code, &header, container, num_blocks) + 1;
+    }
+    finalize(analysis, sizes, num_blocks);
+    return analysis;
+}
+
+void build_jumpdest_index(AdvancedCodeAnalysis& analysis) noexcept
+{
+    auto& index = analysis.jumpdest_index;
+    index.clear();
+    if (analysis.jumpdest_offsets.empty())
+        return;
+
+    // The offsets are sorted so the last one determines the index size.
+    index.resize(static_cast<size_t>(analysis.jumpdest_offsets.back()) / 64 + 1);
+
+    uint32_t rank = 0;
+    size_t next_chunk = 0;  // The first chunk which rank has not been set yet.
+    for (const auto offset : analysis.jumpdest_offsets)
+    {
+        const auto chunk = static_cast<size_t>(offset) / 64;
+        for (; next_chunk <= chunk; ++next_chunk)
+            index[next_chunk].rank = rank;
+        index[chunk].bitmap |= uint64_t{1} << (offset % 64);
+        ++rank;
+    }
+}
 
-    assert(analysis.instrs.size() <= max_instrs_size);
+namespace
+{
+/// The header of the serialized analysis image.
+struct ImageHeader
+{
+    static constexpr uint8_t expected_magic[4] = {'E', 'V', 'M', 'A'};
+    static constexpr uint32_t expected_format_version = 4;
+
+    uint8_t magic[4];
+    uint32_t format_version;
+    uint32_t rev;
+    uint32_t num_instrs;
+    uint32_t num_blocks;
+    uint32_t num_push_values;
+    uint32_t num_partial_block_costs;
+    uint32_t num_jumpdests;
+    uint32_t num_code_sections;
+    uint32_t num_jump_table_entries;
+};
+static_assert(sizeof(ImageHeader) == 40);
+
+/// Calls the function for each analysis buffer with the pointer to its data and its size in bytes.
+/// This defines the order of the buffers in the image.
+template <typename A, typename Fn>
+inline void for_each_buffer(A& analysis, Fn fn) noexcept
+{
+    const auto buffer = [&fn](auto& v) noexcept { fn(v.data(), v.size() * sizeof(v[0])); };
+    buffer(analysis.instrs);
+    buffer(analysis.blocks);
+    buffer(analysis.push_values);
+    buffer(analysis.partial_block_costs);
+    buffer(analysis.jumpdest_offsets);
+    buffer(analysis.jumpdest_targets);
+    buffer(analysis.code_sections);
+    buffer(analysis.jump_tables);
+}
+
+/// Checks if the instruction index is the beginning of a block.
+inline bool is_block_begin(const AdvancedCodeAnalysis& analysis, size_t index) noexcept
+{
+    return index < analysis.instrs.size() && analysis.instrs[index].opcode() == OPX_BEGINBLOCK;
+}
+
+/// Checks if the RJUMPV jump table at the given position is in range and its targets
+/// are the beginnings of blocks.
+bool validate_jump_table(const AdvancedCodeAnalysis& analysis, size_t pos) noexcept
+{
+    const auto& tables = analysis.jump_tables;
+    if (pos >= tables.size() || tables[pos] >= tables.size() - pos)
+        return false;
+    const auto targets = &tables[pos + 1];
+    return std::all_of(targets, targets + tables[pos],
+        [&analysis](uint32_t target) noexcept { return is_block_begin(analysis, target); });
+}
+
+/// Checks if the instruction arguments referencing other analysis buffers are in range.
+bool validate_instructions(const AdvancedCodeAnalysis& analysis) noexcept
+{
+    for (const auto& instr : analysis.instrs)
+    {
+        const auto opcode = instr.opcode();
+        const auto arg = size_t{instr.arg()};
+        if (opcode == OPX_BEGINBLOCK || opcode == OP_JUMPI)
+        {
+            if (arg >= analysis.blocks.size())
+                return false;
+        }
+        else if (opcode > OP_PUSH_INLINE_MAX && opcode <= OP_PUSH32)
+        {
+            if (arg >= analysis.push_values.size())
+                return false;
+        }
+        else if (needs_partial_block_cost(opcode))
+        {
+            if (arg >= analysis.partial_block_costs.size())
+                return false;
+        }
+        else if (opcode == OPX_JUMP_DIRECT && arg != Instruction::max_arg)
+        {
+            if (!is_block_begin(analysis, arg))
+                return false;
+        }
+        else if (opcode == OP_RJUMP || opcode == OP_RJUMPI)
+        {
+            if (!is_block_begin(analysis, arg))
+                return false;
+        }
+        else if (opcode == OP_RJUMPV)
+        {
+            if (!validate_jump_table(analysis, arg))
+                return false;
+        }
+        else if (opcode == OP_CALLF)
+        {
+            if (arg >= analysis.code_sections.size())
+                return false;
+        }
+        else if (opcode == OP_RETF)
+        {
+            // The return stack is only filled by CALLF.
+            if (analysis.code_sections.empty())
+                return false;
+        }
+        else if (opcode == OP_DUPN || opcode == OP_SWAPN)
+        {
+            if (arg > std::numeric_limits<uint8_t>::max())
+                return false;
+        }
+    }
+
+    // The execution must not run past the end of the instructions.
+    return !analysis.instrs.empty() && analysis.instrs.back().opcode() == OP_STOP;
+}
+
+/// Checks if the BlockInfo of every block covers the instructions of the block.
+///
+/// The requirements of the instructions are computed as in the analysis. The BlockInfo computed
+/// from the original code may only be more demanding because the optimizations remove
+/// instructions. The gas cost is then only the lower bound of the original cost.
+/// The instruction arguments must already be validated.
+bool validate_blocks(const AdvancedCodeAnalysis& analysis, evmc_revision rev) noexcept
+{
+    // The instructions before the first block beginning would be executed without checks.
+    if (!is_block_begin(analysis, 0))
+        return false;
+
+    const auto& op_tbl = get_op_table(rev);
+    const auto covers = [&analysis](const BlockAnalysis& block) noexcept {
+        const auto required = block.close();
+        const auto& info = analysis.blocks[block.index];
+        return info.gas_cost >= required.gas_cost && info.stack_req >= required.stack_req &&
+               info.stack_max_growth >= required.stack_max_growth;
+    };
+
+    auto block = BlockAnalysis{analysis.instrs[0].arg()};
+    for (size_t i = 1; i < analysis.instrs.size(); ++i)
+    {
+        const auto& instr = analysis.instrs[i];
+        const auto opcode = instr.opcode();
+        if (opcode == OPX_BEGINBLOCK)
+        {
+            if (!covers(block))
+                return false;
+            block = BlockAnalysis{instr.arg()};
+            continue;
+        }
+
+        int stack_req = op_tbl[opcode].stack_req;
+        int stack_change = op_tbl[opcode].stack_change;
+        if (opcode == OP_DUPN)
+            stack_req = static_cast<int>(instr.arg()) + 1;
+        else if (opcode == OP_SWAPN)
+            stack_req = static_cast<int>(instr.arg()) + 2;
+        else if (opcode == OP_CALLF || opcode == OP_RETF)
+        {
+            // The stack effect depends on the called function. The called section starts with
+            // a block and the execution returns to the block following the CALLF.
+            if (opcode == OP_CALLF && !is_block_begin(analysis, i + 1))
+                return false;
+            stack_req = 0;
+            stack_change = 0;
+        }
+
+        block.stack_req = std::max(block.stack_req, stack_req - block.stack_change);
+        block.stack_change += stack_change;
+        block.stack_max_growth = std::max(block.stack_max_growth, block.stack_change);
+        block.gas_cost += op_tbl[opcode].gas_cost;
+
+        if (opcode == OP_JUMPI)  // The JUMPI holds the block following it.
+        {
+            if (!covers(block))
+                return false;
+            block = BlockAnalysis{instr.arg()};
+        }
+    }
+    return covers(block);
+}
+}  // namespace
+
+bytes serialize(const AdvancedCodeAnalysis& analysis, evmc_revision rev) noexcept
+{
+    ImageHeader header{};
+    std::copy_n(ImageHeader::expected_magic, std::size(header.magic), header.magic);
+    header.format_version = ImageHeader::expected_format_version;
+    header.rev = static_cast<uint32_t>(rev);
+    header.num_instrs = static_cast<uint32_t>(analysis.instrs.size());
+    header.num_blocks = static_cast<uint32_t>(analysis.blocks.size());
+    header.num_push_values = static_cast<uint32_t>(analysis.push_values.size());
+    header.num_partial_block_costs = static_cast<uint32_t>(analysis.partial_block_costs.size());
+    header.num_jumpdests = static_cast<uint32_t>(analysis.jumpdest_offsets.size());
+    header.num_code_sections = static_cast<uint32_t>(analysis.code_sections.size());
+    header.num_jump_table_entries = static_cast<uint32_t>(analysis.jump_tables.size());
+
+    bytes image{reinterpret_cast<const uint8_t*>(&header), sizeof(header)};
+    for_each_buffer(analysis, [&image](const void* data, size_t size) noexcept {
+        if (size != 0)  // The data may be null for empty vectors.
+            image.append(static_cast<const uint8_t*>(data), size);
+    });
+    return image;
+}
+
+std::optional<AdvancedCodeAnalysis> deserialize(bytes_view image, evmc_revision rev) noexcept
+{
+    ImageHeader header;
+    if (image.size() < sizeof(header))
+        return {};
+    std::memcpy(&header, image.data(), sizeof(header));
+
+    if (!std::equal(std::begin(header.magic), std::end(header.magic),
+            std::begin(ImageHeader::expected_magic)) ||
+        header.format_version != ImageHeader::expected_format_version ||
+        header.rev != static_cast<uint32_t>(rev))
+        return {};
+
+    // Check the image size before allocating the buffers.
+    const auto expected_size = sizeof(header) + header.num_instrs * sizeof(Instruction) +
+                               header.num_blocks * sizeof(BlockInfo) +
+                               header.num_push_values * sizeof(intx::uint256) +
+                               header.num_partial_block_costs * sizeof(uint32_t) +
+                               header.num_jumpdests * 2 * sizeof(int32_t) +
+                               header.num_code_sections * sizeof(AdvancedCodeSection) +
+                               header.num_jump_table_entries * sizeof(uint32_t);
+    if (image.size() != expected_size)
+        return {};
+
+    AdvancedCodeAnalysis analysis;
+    analysis.instrs.resize(header.num_instrs);
+    analysis.blocks.resize(header.num_blocks);
+    analysis.push_values.resize(header.num_push_values);
+    analysis.partial_block_costs.resize(header.num_partial_block_costs);
+    analysis.jumpdest_offsets.resize(header.num_jumpdests);
+    analysis.jumpdest_targets.resize(header.num_jumpdests);
+    analysis.code_sections.resize(header.num_code_sections);
+    analysis.jump_tables.resize(header.num_jump_table_entries);
+
+    auto in = image.data() + sizeof(header);
+    for_each_buffer(analysis, [&in](void* data, size_t size) noexcept {
+        if (size != 0)  // The data may be null for empty vectors.
+            std::memcpy(data, in, size);
+        in += size;
+    });
+
+    if (!validate_instructions(analysis) || !validate_blocks(analysis, rev))
+        return {};
+
+    for (const auto& section : analysis.code_sections)
+    {
+        if (!is_block_begin(analysis, section.begin))
+            return {};
+    }
+
+    for (const auto target : analysis.jumpdest_targets)
+    {
+        if (target < 0 || !is_block_begin(analysis, static_cast<size_t>(target)))
+            return {};
+    }
 
-    // Make sure the push_values has not been reallocated. Otherwise iterators are invalid.
-    assert(analysis.push_values.size() <= max_args_storage_size);
+    // The offsets must be non-negative and strictly increasing.
+    const auto& offsets = analysis.jumpdest_offsets;
+    if ((!offsets.empty() && offsets.front() < 0) ||
+        std::adjacent_find(offsets.begin(), offsets.end(), std::greater_equal<>{}) != offsets.end())
+        return {};
 
+    build_jumpdest_index(analysis);
     return analysis;
 }
 
@@ -9,12 +9,15 @@
 #include <evmc/utils.h>
 #include <intx/intx.hpp>
 #include <array>
+#include <bit>
+#include <cassert>
 #include <cstdint>
+#include <optional>
 #include <vector>
 
 namespace evmone::advanced
 {
-struct Instruction;
+class Instruction;
 
 /// Compressed information about instruction basic block.
 struct BlockInfo
@@ -27,6 +30,8 @@ struct BlockInfo
 
     /// The maximum stack height growth relative to the stack height at block start.
     int16_t stack_max_growth = 0;
+
+    friend constexpr bool operator==(const BlockInfo&, const BlockInfo&) noexcept = default;
 };
 static_assert(sizeof(BlockInfo) == 8);
 
@@ -118,16 +123,6 @@ struct AdvancedExecutionState : ExecutionState
     }
 };
 
-union InstructionArgument
-{
-    int64_t number;
-    const intx::uint256* push_value;
-    uint64_t small_push_value;
-    BlockInfo block{};
-};
-static_assert(
-    sizeof(InstructionArgument) == sizeof(uint64_t), "Incorrect size of instruction_argument");
-
 /// The pointer to function implementing an instruction execution.
 using instruction_exec_fn = const Instruction* (*)(const Instruction*, AdvancedExecutionState&);
 
@@ -142,7 +137,20 @@ enum intrinsic_opcodes
     /// This instruction is defined as alias for JUMPDEST and replaces all JUMPDEST instructions.
     /// It is also injected at beginning of basic blocks not being the valid jump destination.
     /// It checks basic block execution requirements and terminates execution if they are not met.
-    OPX_BEGINBLOCK = OP_JUMPDEST
+    OPX_BEGINBLOCK = OP_JUMPDEST,
+
+    /// The undefined instruction.
+    ///
+    /// The analysis replaces all instructions undefined in the revision and in the kind of code
+    /// (legacy or EOF) with OPX_UNDEFINED. This includes the opcodes of the intrinsic instructions
+    /// below which use opcode slots undefined in all EVM revisions.
+    OPX_UNDEFINED = 0x0c,
+
+    /// The JUMP to the destination known in the analysis phase.
+    ///
+    /// This instruction replaces the PUSH+JUMP pair. The argument is the index of the target
+    /// instruction or Instruction::max_arg if the destination is invalid.
+    OPX_JUMP_DIRECT = 0x0d,
 };
 
 struct OpTableEntry
@@ -155,21 +163,101 @@ struct OpTableEntry
 
 using OpTable = std::array<OpTableEntry, 256>;
 
-struct Instruction
+/// The instruction of the Advanced interpreter packed into 32 bits:
+/// the opcode selecting the implementation from the OpTable and the 24-bit argument.
+///
+/// The meaning of the argument depends on the instruction:
+/// - BEGINBLOCK, JUMPI: the index of the block in AdvancedCodeAnalysis::blocks,
+/// - PUSH1–PUSH3: the push value,
+/// - PUSH4–PUSH32: the index of the value in AdvancedCodeAnalysis::push_values,
+/// - GAS, SSTORE, CALL*, CREATE*:
+///   the index of the cost in AdvancedCodeAnalysis::partial_block_costs,
+/// - PC: the code offset of the instruction,
+/// - OPX_JUMP_DIRECT, RJUMP, RJUMPI: the index of the target instruction,
+/// - RJUMPV: the position of the jump table in AdvancedCodeAnalysis::jump_tables,
+/// - CALLF: the index of the code section in AdvancedCodeAnalysis::code_sections,
+/// - DUPN, SWAPN: the immediate argument.
+class Instruction
+{
+    uint32_t m_data = 0;
+
+public:
+    /// The maximum value of the instruction argument.
+    static constexpr uint32_t max_arg = (uint32_t{1} << 24) - 1;
+
+    constexpr Instruction() noexcept = default;
+
+    explicit constexpr Instruction(uint8_t opcode, uint32_t arg = 0) noexcept
+      : m_data{opcode | (arg << 8)}
+    {
+        assert(arg <= max_arg);
+    }
+
+    [[nodiscard]] constexpr uint8_t opcode() const noexcept
+    {
+        return static_cast<uint8_t>(m_data);
+    }
+
+    [[nodiscard]] constexpr uint32_t arg() const noexcept { return m_data >> 8; }
+
+    friend constexpr bool operator==(Instruction, Instruction) noexcept = default;
+};
+static_assert(sizeof(Instruction) == 4);
+
+/// The largest PUSH instruction which value is stored in the instruction argument.
+constexpr auto OP_PUSH_INLINE_MAX = OP_PUSH3;
+
+/// The maximum code size supported by the analysis.
+/// Instruction indexes and code offsets must fit the 24-bit instruction argument.
+constexpr size_t max_code_size = Instruction::max_arg - 1;
+
+/// The maximum EOF container size supported by the analysis.
+/// The analysis of EOF code may inject up to one BEGINBLOCK per code byte.
+constexpr size_t max_eof_container_size = max_code_size / 2;
+
+/// The entry of the jump destination index covering 64 bytes of code.
+struct JumpdestIndexEntry
 {
-    instruction_exec_fn fn = nullptr;
-    InstructionArgument arg;
+    /// The bitmap of JUMPDEST offsets in the 64-byte code chunk (bit i is offset 64*k + i).
+    uint64_t bitmap = 0;
 
-    explicit constexpr Instruction(instruction_exec_fn f) noexcept : fn{f}, arg{} {}
+    /// The number of JUMPDESTs in all preceding chunks,
+    /// i.e. the position in jumpdest_targets of the first JUMPDEST in this chunk.
+    uint32_t rank = 0;
 };
 
+/// The EOF code section in the Advanced code analysis.
+struct AdvancedCodeSection
+{
+    /// The index of the first instruction (BEGINBLOCK) of the section.
+    uint32_t begin = 0;
+
+    /// The maximum stack height of the section from the EOF type section.
+    uint32_t max_stack_height = 0;
+
+    friend constexpr bool operator==(
+        const AdvancedCodeSection&, const AdvancedCodeSection&) noexcept = default;
+};
+
+/// The result of the Advanced code analysis.
+///
+/// All buffers are sized by the first analysis pass (the optimizations may only leave them
+/// partially used). E.g. for a 24 KiB contract with 16k instructions and 1.5k basic blocks
+/// this takes ~90 KiB in total.
 struct AdvancedCodeAnalysis
 {
     std::vector<Instruction> instrs;
 
-    /// Storage for large push values.
+    /// The information about basic blocks referenced by BEGINBLOCK and JUMPI instructions.
+    std::vector<BlockInfo> blocks;
+
+    /// Storage for push values not fitting the instruction argument.
     std::vector<intx::uint256> push_values;
 
+    /// The base gas costs of the instructions preceding the given instruction in its block.
+    /// This is needed by instructions which require the exact "gas left" value.
+    std::vector<uint32_t> partial_block_costs;
+
     /// The offsets of JUMPDESTs in the original code.
     /// These are values that JUMP/JUMPI receives as an argument.
     /// The elements are sorted.
@@ -179,20 +267,85 @@ struct AdvancedCodeAnalysis
     /// matching the elements from jumdest_offsets.
     /// This is value to which the next instruction pointer must be set in JUMP/JUMPI.
     std::vector<int32_t> jumpdest_targets;
+
+    /// The two-level index of jumpdest_offsets for constant-time lookups in find_jumpdest().
+    ///
+    /// This takes 16 bytes per 64 bytes of code up to the last JUMPDEST, e.g. 6 KiB for
+    /// a 24 KiB contract, compared to 96 KiB of the dense offset→instruction table.
+    /// It is built by build_jumpdest_index().
+    std::vector<JumpdestIndexEntry> jumpdest_index;
+
+    /// The EOF code sections. Empty for legacy code.
+    std::vector<AdvancedCodeSection> code_sections;
+
+    /// The jump tables of the RJUMPV instructions: the number of cases
+    /// followed by the indexes of the target instructions.
+    std::vector<uint32_t> jump_tables;
 };
 
+/// Builds AdvancedCodeAnalysis::jumpdest_index from AdvancedCodeAnalysis::jumpdest_offsets.
+EVMC_EXPORT void build_jumpdest_index(AdvancedCodeAnalysis& analysis) noexcept;
+
+/// Finds the index of the instruction the jump to the given code offset lands on.
+///
+/// @return The instruction index or -1 if the offset is not a valid jump destination.
 inline int find_jumpdest(const AdvancedCodeAnalysis& analysis, int offset) noexcept
 {
-    const auto begin = std::begin(analysis.jumpdest_offsets);
-    const auto end = std::end(analysis.jumpdest_offsets);
-    const auto it = std::lower_bound(begin, end, offset);
-    return (it != end && *it == offset) ?
-               analysis.jumpdest_targets[static_cast<size_t>(it - begin)] :
-               -1;
+    // Negative offsets are wrapped to values out of the index range.
+    const auto chunk_index = static_cast<size_t>(static_cast<unsigned>(offset) / 64);
+    if (chunk_index >= analysis.jumpdest_index.size())
+        return -1;
+
+    const auto& entry = analysis.jumpdest_index[chunk_index];
+    const auto bit = uint64_t{1} << (static_cast<unsigned>(offset) % 64);
+    if ((entry.bitmap & bit) == 0)
+        return -1;
+
+    const auto rank = entry.rank + static_cast<uint32_t>(std::popcount(entry.bitmap & (bit - 1)));
+    return analysis.jumpdest_targets[rank];
 }
 
+/// Analyzes the code for the Advanced interpreter.
+///
+/// The instructions within a basic block are optimized:
+/// - pure arithmetic instructions with constant arguments are folded to a single PUSH,
+/// - DUPn POP and SWAPn SWAPn pairs are removed,
+/// - PUSH+JUMP pairs are replaced with OPX_JUMP_DIRECT.
+/// The BlockInfo of a block is computed from the original instructions so the gas cost
+/// and the stack requirements are not affected.
+///
+/// The code size must not exceed max_code_size.
 EVMC_EXPORT AdvancedCodeAnalysis analyze(evmc_revision rev, bytes_view code) noexcept;
 
+/// Analyzes all code sections of the valid EOF1 container for the Advanced interpreter.
+///
+/// The sections are placed one after another in AdvancedCodeAnalysis::instrs and each of them
+/// starts with BEGINBLOCK. The relative jumps are resolved to instruction indexes. New blocks
+/// are started at the jump targets and after RJUMPI, RJUMPV and CALLF.
+///
+/// The container size must not exceed max_eof_container_size.
+EVMC_EXPORT AdvancedCodeAnalysis analyze_eof1(evmc_revision rev, bytes_view container) noexcept;
+
+/// Serializes the code analysis to a binary image.
+///
+/// The analysis does not contain any pointers so the image is position-independent.
+/// It consists of a fixed-size header followed by the analysis buffers, so it can be written
+/// to a file and mmapped. The native byte order is used.
+EVMC_EXPORT bytes serialize(const AdvancedCodeAnalysis& analysis, evmc_revision rev) noexcept;
+
+/// Restores the code analysis from the binary image created by serialize().
+///
+/// The image may be at any address alignment (e.g. a slice of a mmapped file).
+/// Returns std::nullopt if the image is malformed or was created for a different revision.
+///
+/// The image is validated so that its execution is memory-safe: the instruction arguments
+/// are in range, the jump targets are block beginnings and the stack requirements of every
+/// block cover its instructions. The gas costs of the instructions removed by the optimizations
+/// cannot be recomputed, so the block gas costs are only checked against the lower bound.
+/// The image must come from serialize() of a trusted analysis for the gas charges to be exact.
+EVMC_EXPORT std::optional<AdvancedCodeAnalysis> deserialize(
+    bytes_view image, evmc_revision rev) noexcept;
+
 EVMC_EXPORT const OpTable& get_op_table(evmc_revision rev) noexcept;
 
 }  // namespace evmone::advanced
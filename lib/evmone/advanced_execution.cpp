@@ -4,7 +4,9 @@
 
 #include "advanced_execution.hpp"
 #include "advanced_analysis.hpp"
+#include "baseline.hpp"
 #include "eof.hpp"
+#include "vm.hpp"
 #include <memory>
 
 namespace evmone::advanced
@@ -13,9 +15,10 @@ evmc_result execute(AdvancedExecutionState& state, const AdvancedCodeAnalysis& a
 {
     state.analysis.advanced = &analysis;  // Allow accessing the analysis by instructions.
 
+    const auto& op_tbl = get_op_table(state.rev);
     const auto* instr = state.analysis.advanced->instrs.data();  // Get the first instruction.
     while (instr != nullptr)
-        instr = instr->fn(instr, state);
+        instr = op_tbl[instr->opcode()].fn(instr, state);
 
     const auto gas_left =
         (state.status == EVMC_SUCCESS || state.status == EVMC_REVERT) ? state.gas_left : 0;
@@ -26,26 +29,27 @@ evmc_result execute(AdvancedExecutionState& state, const AdvancedCodeAnalysis& a
         state.memory.data() + state.output_offset, state.output_size);
 }
 
-evmc_result execute(evmc_vm* /*unused*/, const evmc_host_interface* host, evmc_host_context* ctx,
+evmc_result execute(evmc_vm* c_vm, const evmc_host_interface* host, evmc_host_context* ctx,
     evmc_revision rev, const evmc_message* msg, const uint8_t* code, size_t code_size) noexcept
 {
-    AdvancedCodeAnalysis analysis;
     const bytes_view container = {code, code_size};
-    if (is_eof_container(container))
-    {
-        if (rev >= EVMC_CANCUN)
-        {
-            const auto eof1_header = read_valid_eof1_header(container);
-            analysis = analyze(rev, eof1_header.get_code(container, 0));
-        }
-        else
-            // Skip analysis, because it will recognize 01 section id as OP_ADD and return
-            // EVMC_STACKUNDERFLOW.
-            return evmc::make_result(EVMC_UNDEFINED_INSTRUCTION, 0, 0, nullptr, 0);
-    }
-    else
-        analysis = analyze(rev, container);
+    const auto eof = is_eof_container(container);
+
+    // Skip analysis, because it will recognize 01 section id as OP_ADD and return
+    // EVMC_STACKUNDERFLOW.
+    if (eof && rev < EVMC_CANCUN)
+        return evmc::make_result(EVMC_UNDEFINED_INSTRUCTION, 0, 0, nullptr, 0);
+
+    // The code not fitting the compact analysis is executed by Baseline.
+    if (INTX_UNLIKELY(code_size > (eof ? max_eof_container_size : max_code_size)))
+        return baseline::execute(c_vm, host, ctx, rev, msg, code, code_size);
+
+    const auto analysis = eof ? analyze_eof1(rev, container) : analyze(rev, container);
     auto state = std::make_unique<AdvancedExecutionState>(*msg, rev, *host, ctx, container);
+
+    state->keccak_cache = static_cast<VM*>(c_vm)->get_keccak_cache();
+    if (state->keccak_cache != nullptr && msg->depth == 0)
+        state->keccak_cache->clear();  // The cache lives for a single transaction.
     return execute(*state, analysis);
 }
 }  // namespace evmone::advanced
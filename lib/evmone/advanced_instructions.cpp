@@ -109,9 +109,18 @@ const Instruction* op(const Instruction* /*instr*/, AdvancedExecutionState& stat
     return state.exit(result.status);
 }
 
+/// Returns the base gas cost of the instructions in the current block
+/// following the given instruction.
+inline int64_t compute_gas_left_correction(
+    const Instruction* instr, const AdvancedExecutionState& state) noexcept
+{
+    return int64_t{state.current_block_cost} -
+           state.analysis.advanced->partial_block_costs[instr->arg()];
+}
+
 const Instruction* op_sstore(const Instruction* instr, AdvancedExecutionState& state) noexcept
 {
-    const auto gas_left_correction = state.current_block_cost - instr->arg.number;
+    const auto gas_left_correction = compute_gas_left_correction(instr, state);
     state.gas_left += gas_left_correction;
 
     const auto status = instr::impl<OP_SSTORE>(state);
@@ -126,7 +135,7 @@ const Instruction* op_sstore(const Instruction* instr, AdvancedExecutionState& s
 
 const Instruction* opx_beginblock(const Instruction* instr, AdvancedExecutionState& state) noexcept
 {
-    auto& block = instr->arg.block;
+    const auto& block = state.analysis.advanced->blocks[instr->arg()];
 
     if ((state.gas_left -= block.gas_cost) < 0)
         return state.exit(EVMC_OUT_OF_GAS);
@@ -152,6 +161,15 @@ const Instruction* op_jump(const Instruction*, AdvancedExecutionState& state) no
     return &state.analysis.advanced->instrs[static_cast<size_t>(pc)];
 }
 
+const Instruction* opx_jump_direct(const Instruction* instr, AdvancedExecutionState& state) noexcept
+{
+    const auto target = instr->arg();
+    if (target == Instruction::max_arg)
+        return state.exit(EVMC_BAD_JUMP_DESTINATION);
+
+    return &state.analysis.advanced->instrs[target];
+}
+
 const Instruction* op_jumpi(const Instruction* instr, AdvancedExecutionState& state) noexcept
 {
     if (state.stack[1] != 0)
@@ -168,15 +186,77 @@ const Instruction* op_jumpi(const Instruction* instr, AdvancedExecutionState& st
     return instr;
 }
 
+const Instruction* op_rjump(const Instruction* instr, AdvancedExecutionState& state) noexcept
+{
+    return &state.analysis.advanced->instrs[instr->arg()];
+}
+
+const Instruction* op_rjumpi(const Instruction* instr, AdvancedExecutionState& state) noexcept
+{
+    if (state.stack.pop() != 0)
+        return op_rjump(instr, state);
+    return ++instr;  // follow-by block
+}
+
+const Instruction* op_rjumpv(const Instruction* instr, AdvancedExecutionState& state) noexcept
+{
+    const auto& analysis = *state.analysis.advanced;
+    const auto table = &analysis.jump_tables[instr->arg()];
+    const auto case_ = state.stack.pop();
+    if (case_ >= table[0])
+        return ++instr;  // follow-by block
+
+    return &analysis.instrs[table[1 + static_cast<uint32_t>(case_)]];
+}
+
+const Instruction* op_callf(const Instruction* instr, AdvancedExecutionState& state) noexcept
+{
+    const auto& analysis = *state.analysis.advanced;
+    const auto& section = analysis.code_sections[instr->arg()];
+    // TODO: Add different error code for the return stack overflow.
+    if (INTX_UNLIKELY(
+            state.stack.size() + static_cast<int>(section.max_stack_height) > StackSpace::limit ||
+            state.call_stack.full()))
+        return state.exit(EVMC_STACK_OVERFLOW);
+
+    state.call_stack.push(instr + 1);  // follow-by block
+    return &analysis.instrs[section.begin];
+}
+
+const Instruction* op_retf(const Instruction*, AdvancedExecutionState& state) noexcept
+{
+    return static_cast<const Instruction*>(state.call_stack.pop());
+}
+
+const Instruction* op_dupn(const Instruction* instr, AdvancedExecutionState& state) noexcept
+{
+    const auto n = static_cast<int>(instr->arg()) + 1;
+    if (state.stack.size() < n)
+        return state.exit(EVMC_STACK_UNDERFLOW);
+
+    state.stack.push(state.stack[n - 1]);
+    return ++instr;
+}
+
+const Instruction* op_swapn(const Instruction* instr, AdvancedExecutionState& state) noexcept
+{
+    const auto n = static_cast<int>(instr->arg()) + 1;
+    if (state.stack.size() <= n)
+        return state.exit(EVMC_STACK_UNDERFLOW);
+
+    std::swap(state.stack.top(), state.stack[n]);
+    return ++instr;
+}
+
 const Instruction* op_pc(const Instruction* instr, AdvancedExecutionState& state) noexcept
 {
-    state.stack.push(instr->arg.number);
+    state.stack.push(instr->arg());
     return ++instr;
 }
 
 const Instruction* op_gas(const Instruction* instr, AdvancedExecutionState& state) noexcept
 {
-    const auto correction = state.current_block_cost - instr->arg.number;
+    const auto correction = compute_gas_left_correction(instr, state);
     const auto gas = static_cast<uint64_t>(state.gas_left + correction);
     state.stack.push(gas);
     return ++instr;
@@ -184,20 +264,20 @@ const Instruction* op_gas(const Instruction* instr, AdvancedExecutionState& stat
 
 const Instruction* op_push_small(const Instruction* instr, AdvancedExecutionState& state) noexcept
 {
-    state.stack.push(instr->arg.small_push_value);
+    state.stack.push(instr->arg());
     return ++instr;
 }
 
 const Instruction* op_push_full(const Instruction* instr, AdvancedExecutionState& state) noexcept
 {
-    state.stack.push(*instr->arg.push_value);
+    state.stack.push(state.analysis.advanced->push_values[instr->arg()]);
     return ++instr;
 }
 
 template <Opcode Op>
 const Instruction* op_call(const Instruction* instr, AdvancedExecutionState& state) noexcept
 {
-    const auto gas_left_correction = state.current_block_cost - instr->arg.number;
+    const auto gas_left_correction = compute_gas_left_correction(instr, state);
     state.gas_left += gas_left_correction;
 
     const auto status = instr::impl<Op>(state);
@@ -213,7 +293,7 @@ const Instruction* op_call(const Instruction* instr, AdvancedExecutionState& sta
 template <Opcode Op>
 const Instruction* op_create(const Instruction* instr, AdvancedExecutionState& state) noexcept
 {
-    const auto gas_left_correction = state.current_block_cost - instr->arg.number;
+    const auto gas_left_correction = compute_gas_left_correction(instr, state);
     state.gas_left += gas_left_correction;
 
     const auto status = instr::impl<Op>(state);
@@ -231,6 +311,19 @@ const Instruction* op_undefined(const Instruction*, AdvancedExecutionState& stat
     return state.exit(EVMC_UNDEFINED_INSTRUCTION);
 }
 
+/// Checks if the opcode is undefined in all EVM revisions
+/// so its slot can be used by an intrinsic instruction.
+constexpr bool is_unused_opcode(uint8_t opcode) noexcept
+{
+    for (size_t r = EVMC_FRONTIER; r <= EVMC_MAX_REVISION; ++r)
+    {
+        if (instr::gas_costs[r][opcode] != instr::undefined)
+            return false;
+    }
+    return true;
+}
+static_assert(is_unused_opcode(OPX_UNDEFINED));
+static_assert(is_unused_opcode(OPX_JUMP_DIRECT));
 
 constexpr std::array<instruction_exec_fn, 256> instruction_implementations = []() noexcept {
     std::array<instruction_exec_fn, 256> table{};
@@ -248,9 +341,9 @@ constexpr std::array<instruction_exec_fn, 256> instruction_implementations = [](
     table[OP_GAS] = op_gas;
     table[OP_JUMPDEST] = opx_beginblock;
 
-    for (auto op = size_t{OP_PUSH1}; op <= OP_PUSH8; ++op)
+    for (auto op = size_t{OP_PUSH1}; op <= OP_PUSH_INLINE_MAX; ++op)
         table[op] = op_push_small;
-    for (auto op = size_t{OP_PUSH9}; op <= OP_PUSH32; ++op)
+    for (auto op = size_t{OP_PUSH_INLINE_MAX + 1}; op <= OP_PUSH32; ++op)
         table[op] = op_push_full;
 
     table[OP_CREATE] = op_create<OP_CREATE>;
@@ -260,14 +353,14 @@ constexpr std::array<instruction_exec_fn, 256> instruction_implementations = [](
     table[OP_CREATE2] = op_create<OP_CREATE2>;
     table[OP_STATICCALL] = op_call<OP_STATICCALL>;
 
-    table[OP_RJUMP] = op_undefined;
-    table[OP_RJUMPI] = op_undefined;
-    table[OP_RJUMPV] = op_undefined;
-    table[OP_CALLF] = op_undefined;
-    table[OP_RETF] = op_undefined;
+    table[OP_RJUMP] = op_rjump;
+    table[OP_RJUMPI] = op_rjumpi;
+    table[OP_RJUMPV] = op_rjumpv;
+    table[OP_CALLF] = op_callf;
+    table[OP_RETF] = op_retf;
 
-    table[OP_DUPN] = op_undefined;
-    table[OP_SWAPN] = op_undefined;
+    table[OP_DUPN] = op_dupn;
+    table[OP_SWAPN] = op_swapn;
 
     return table;
 }();
@@ -297,6 +390,9 @@ EVMC_EXPORT const OpTable& get_op_table(evmc_revision rev) noexcept
                     t.stack_change = instr::traits[i].stack_height_change;
                 }
             }
+
+            // The intrinsic instructions are only produced by the analysis.
+            table[OPX_JUMP_DIRECT].fn = opx_jump_direct;
         }
         return tables;
     }();
@@ -8,7 +8,11 @@
 #include "execution_state.hpp"
 #include "instructions.hpp"
 #include "vm.hpp"
+#include <ethash/keccak.hpp>
+#include <chrono>
+#include <cstring>
 #include <memory>
+#include <optional>
 
 #ifdef NDEBUG
 #define release_inline gnu::always_inline, msvc::forceinline
@@ -69,17 +73,22 @@ CodeAnalysis analyze_legacy(bytes_view code)
 
 CodeAnalysis analyze_eof1(bytes_view container)
 {
-    auto header = read_valid_eof1_header(container);
+    const auto header = read_valid_eof1_header(container);
 
     // Extract all code sections as single buffer reference.
-    // TODO: It would be much easier if header had code_sections_offset and data_section_offset
-    //       with code_offsets[] being relative to code_sections_offset.
-    const auto code_sections_offset = header.code_offsets[0];
-    const auto code_sections_end = size_t{header.code_offsets.back()} + header.code_sizes.back();
-    const auto executable_code =
-        container.substr(code_sections_offset, code_sections_end - code_sections_offset);
-
-    return CodeAnalysis{executable_code, std::move(header)};
+    const auto executable_code = header.get_code_sections(container);
+
+    std::vector<CodeSection> code_sections;
+    code_sections.reserve(header.num_code_sections);
+    auto code_pos = executable_code.data();
+    for (size_t i = 0; i < header.num_code_sections; ++i)
+    {
+        const auto type = header.get_type(container, i);
+        code_sections.push_back({code_pos, type.inputs, type.outputs, type.max_stack_height});
+        code_pos += header.get_code_size(container, i);
+    }
+
+    return CodeAnalysis{executable_code, header, std::move(code_sections)};
 }
 }  // namespace
 
@@ -100,6 +109,9 @@ namespace
 /// - charges the instruction base gas cost and checks is there is any gas left.
 ///
 /// @tparam         Op            Instruction opcode.
+/// @tparam         CheckStack    Whether to check the stack height requirements. The checks are
+///                               redundant for the EOF code: the validation proves the stack
+///                               never underflows and its max height is checked on section entry.
 /// @param          cost_table    Table of base gas costs.
 /// @param [in,out] gas_left      Gas left.
 /// @param          stack_top     Pointer to the stack top item.
@@ -107,7 +119,7 @@ namespace
 ///                               The stack height is stack_top - stack_bottom.
 /// @return  Status code with information which check has failed
 ///          or EVMC_SUCCESS if everything is fine.
-template <Opcode Op>
+template <Opcode Op, bool CheckStack>
 inline evmc_status_code check_requirements(const CostTable& cost_table, int64_t& gas_left,
     const uint256* stack_top, const uint256* stack_bottom) noexcept
 {
@@ -128,14 +140,14 @@ inline evmc_status_code check_requirements(const CostTable& cost_table, int64_t&
 
     // Check stack requirements first. This is order is not required,
     // but it is nicer because complete gas check may need to inspect operands.
-    if constexpr (instr::traits[Op].stack_height_change > 0)
+    if constexpr (CheckStack && instr::traits[Op].stack_height_change > 0)
     {
         static_assert(instr::traits[Op].stack_height_change == 1,
             "unexpected instruction with multiple results");
         if (INTX_UNLIKELY(stack_top == stack_bottom + StackSpace::limit))
             return EVMC_STACK_OVERFLOW;
     }
-    if constexpr (instr::traits[Op].stack_height_required > 0)
+    if constexpr (CheckStack && instr::traits[Op].stack_height_required > 0)
     {
         // Check stack underflow using pointer comparison <= (better optimization).
         static constexpr auto min_offset = instr::traits[Op].stack_height_required - 1;
@@ -206,11 +218,12 @@ struct Position
 /// @}
 
 /// A helper to invoke the instruction implementation of the given opcode Op.
-template <Opcode Op>
+template <Opcode Op, bool CheckStack>
 [[release_inline]] inline Position invoke(const CostTable& cost_table, const uint256* stack_bottom,
     Position pos, int64_t& gas, ExecutionState& state) noexcept
 {
-    if (const auto status = check_requirements<Op>(cost_table, gas, pos.stack_top, stack_bottom);
+    if (const auto status =
+            check_requirements<Op, CheckStack>(cost_table, gas, pos.stack_top, stack_bottom);
         status != EVMC_SUCCESS)
     {
         state.status = status;
@@ -221,16 +234,56 @@ template <Opcode Op>
     return {new_pos, new_stack_top};
 }
 
+/// Records the sample of the instruction at the given position.
+/// The code hash is computed by the first sample of the execution.
+/// The sample pc is the offset in the original code, i.e. in the container for EOF code,
+/// so it refers to the same bytes as the code hash.
+[[gnu::noinline]] void record_sample(Sampler& sampler, const ExecutionState& state,
+    const uint8_t* code, code_iterator pos, std::optional<evmc::bytes32>& code_hash) noexcept
+{
+    const auto& analysis = *state.analysis.baseline;
+    const auto code_offset = static_cast<size_t>(pos - code);
+    if (code_offset >= analysis.executable_code.size())  // Skip STOP from code padding.
+        return;
+    const auto offset =
+        static_cast<uint32_t>(code_offset + analysis.eof_header.code_sections_offset);
+
+    if (!code_hash.has_value())
+    {
+        const auto h = ethash::keccak256(state.original_code.data(), state.original_code.size());
+        code_hash.emplace();
+        std::memcpy(code_hash->bytes, h.bytes, sizeof(code_hash->bytes));
+    }
+    sampler.record({*code_hash, offset, *pos, state.msg->depth});
+}
+
+/// The lightweight instrumentation of the untraced interpreter loop.
+/// Each probe is compiled into the loop only when enabled by the dispatch() template parameter.
+struct Probes
+{
+    Sampler* sampler = nullptr;
+    uint8_t* coverage = nullptr;  ///< The executed basic blocks bitmap of the code.
+    ExecutionStats* stats = nullptr;
+
+    [[nodiscard]] bool any() const noexcept
+    {
+        return sampler != nullptr || coverage != nullptr || stats != nullptr;
+    }
+};
 
-template <bool TracingEnabled>
+template <bool TracingEnabled, bool CheckStack, bool SamplingEnabled = false,
+    bool CoverageEnabled = false, bool StatsEnabled = false>
 int64_t dispatch(const CostTable& cost_table, ExecutionState& state, int64_t gas,
-    const uint8_t* code, Tracer* tracer = nullptr) noexcept
+    const uint8_t* code, Tracer* tracer = nullptr, Probes probes = {}) noexcept
 {
     const auto stack_bottom = state.stack_space.bottom();
 
     // Code iterator and stack top pointer for interpreter loop.
     Position position{code, stack_bottom};
 
+    [[maybe_unused]] std::optional<evmc::bytes32> code_hash;
+    [[maybe_unused]] bool block_start = true;
+
     while (true)  // Guaranteed to terminate because padded code ends with STOP.
     {
         if constexpr (TracingEnabled)
@@ -245,22 +298,49 @@ int64_t dispatch(const CostTable& cost_table, ExecutionState& state, int64_t gas
         }
 
         const auto op = *position.code_it;
+
+        if constexpr (SamplingEnabled)
+        {
+            if (INTX_UNLIKELY(probes.sampler->tick()))
+                record_sample(*probes.sampler, state, code, position.code_it, code_hash);
+        }
+
+        if constexpr (CoverageEnabled)
+        {
+            // Mark the basic block entry: the code beginning, JUMPDEST or JUMPI fallthrough.
+            if (block_start || op == OP_JUMPDEST)
+            {
+                const auto offset = static_cast<size_t>(position.code_it - code);
+                probes.coverage[offset / 8] |= static_cast<uint8_t>(1 << (offset % 8));
+            }
+            block_start = op == OP_JUMPI;
+        }
+
+        if constexpr (StatsEnabled)
+        {
+            ++probes.stats->num_instructions;
+            const auto stack_height = static_cast<uint32_t>(position.stack_top - stack_bottom);
+            if (stack_height > probes.stats->peak_stack_height)
+                probes.stats->peak_stack_height = stack_height;
+        }
+
         switch (op)
         {
-#define ON_OPCODE(OPCODE)                                                                     \
-    case OPCODE:                                                                              \
-        ASM_COMMENT(OPCODE);                                                                  \
-        if (const auto next = invoke<OPCODE>(cost_table, stack_bottom, position, gas, state); \
-            next.code_it == nullptr)                                                          \
-        {                                                                                     \
-            return gas;                                                                       \
-        }                                                                                     \
-        else                                                                                  \
-        {                                                                                     \
-            /* Update current position only when no error,                                    \
-               this improves compiler optimization. */                                        \
-            position = next;                                                                  \
-        }                                                                                     \
+#define ON_OPCODE(OPCODE)                                                                  \
+    case OPCODE:                                                                           \
+        ASM_COMMENT(OPCODE);                                                               \
+        if (const auto next = invoke<OPCODE, CheckStack>(                                  \
+                cost_table, stack_bottom, position, gas, state);                           \
+            next.code_it == nullptr)                                                       \
+        {                                                                                  \
+            return gas;                                                                    \
+        }                                                                                  \
+        else                                                                               \
+        {                                                                                  \
+            /* Update current position only when no error,                                 \
+               this improves compiler optimization. */                                     \
+            position = next;                                                               \
+        }                                                                                  \
         break;
 
             MAP_OPCODES
@@ -274,7 +354,31 @@ int64_t dispatch(const CostTable& cost_table, ExecutionState& state, int64_t gas
     intx::unreachable();
 }
 
+/// Selects the dispatch() variant with exactly the enabled probes compiled in.
+/// The template parameters are the probe flags decided so far, in the dispatch() order.
+template <bool CheckStack, bool... Enabled>
+int64_t dispatch_probes(const CostTable& cost_table, ExecutionState& state, int64_t gas,
+    const uint8_t* code, const Probes& probes) noexcept
+{
+    constexpr auto num_decided = sizeof...(Enabled);
+    if constexpr (num_decided == 3)
+        return dispatch<false, CheckStack, Enabled...>(cost_table, state, gas, code, {}, probes);
+    else
+    {
+        const auto enabled = (num_decided == 0) ? probes.sampler != nullptr :
+                             (num_decided == 1) ? probes.coverage != nullptr :
+                                                  probes.stats != nullptr;
+        if (enabled)
+        {
+            return dispatch_probes<CheckStack, Enabled..., true>(
+                cost_table, state, gas, code, probes);
+        }
+        return dispatch_probes<CheckStack, Enabled..., false>(cost_table, state, gas, code, probes);
+    }
+}
+
 #if EVMONE_CGOTO_SUPPORTED
+template <bool CheckStack>
 int64_t dispatch_cgoto(
     const CostTable& cost_table, ExecutionState& state, int64_t gas, const uint8_t* code) noexcept
 {
@@ -298,19 +402,20 @@ int64_t dispatch_cgoto(
 
     goto* cgoto_table[*position.code_it];
 
-#define ON_OPCODE(OPCODE)                                                                 \
-    TARGET_##OPCODE : ASM_COMMENT(OPCODE);                                                \
-    if (const auto next = invoke<OPCODE>(cost_table, stack_bottom, position, gas, state); \
-        next.code_it == nullptr)                                                          \
-    {                                                                                     \
-        return gas;                                                                       \
-    }                                                                                     \
-    else                                                                                  \
-    {                                                                                     \
-        /* Update current position only when no error,                                    \
-           this improves compiler optimization. */                                        \
-        position = next;                                                                  \
-    }                                                                                     \
+#define ON_OPCODE(OPCODE)                                                                      \
+    TARGET_##OPCODE : ASM_COMMENT(OPCODE);                                                     \
+    if (const auto next =                                                                      \
+            invoke<OPCODE, CheckStack>(cost_table, stack_bottom, position, gas, state);        \
+        next.code_it == nullptr)                                                               \
+    {                                                                                          \
+        return gas;                                                                            \
+    }                                                                                          \
+    else                                                                                       \
+    {                                                                                          \
+        /* Update current position only when no error,                                         \
+           this improves compiler optimization. */                                             \
+        position = next;                                                                       \
+    }                                                                                          \
     goto* cgoto_table[*position.code_it];
 
     MAP_OPCODES
@@ -328,24 +433,59 @@ evmc_result execute(
 {
     state.analysis.baseline = &analysis;  // Assign code analysis for instruction implementations.
 
+    state.keccak_cache = vm.get_keccak_cache();
+    if (state.keccak_cache != nullptr && state.msg->depth == 0)
+        state.keccak_cache->clear();  // The cache lives for a single transaction.
+
     const auto code = analysis.executable_code;
 
     const auto& cost_table = get_baseline_cost_table(state.rev, analysis.eof_header.version);
 
+    // The EOF code is valid so the stack checks are only done at the code section entry:
+    // by CALLF and here for the first section.
+    const auto eof = analysis.eof_header.version != 0;
+    assert(!eof || analysis.code_sections[0].max_stack_height <= StackSpace::limit);
+
     auto* tracer = vm.get_tracer();
+    // The tracers observing only the call frames do not need the traced interpreter loop.
+    const auto trace_instructions = tracer != nullptr && tracer->wants_instructions();
+    auto* const stats = vm.get_stats();
+    Probes probes{vm.get_sampler(), nullptr, stats};
+    if (auto* const coverage = vm.get_coverage();
+        coverage != nullptr && !eof && !trace_instructions)
+        probes.coverage = coverage->enter(state.original_code, analysis.jumpdest_map);
+
     if (INTX_UNLIKELY(tracer != nullptr))
-    {
         tracer->notify_execution_start(state.rev, *state.msg, analysis.executable_code);
-        gas = dispatch<true>(cost_table, state, gas, code.data(), tracer);
+
+    if (INTX_UNLIKELY(trace_instructions))
+        gas = dispatch<true, true>(cost_table, state, gas, code.data(), tracer);
+    else if (INTX_UNLIKELY(probes.any()))
+    {
+        // The probes are supported by the switch-based loop only.
+        gas = eof ? dispatch_probes<false>(cost_table, state, gas, code.data(), probes) :
+                    dispatch_probes<true>(cost_table, state, gas, code.data(), probes);
     }
     else
     {
 #if EVMONE_CGOTO_SUPPORTED
         if (vm.cgoto)
-            gas = dispatch_cgoto(cost_table, state, gas, code.data());
+        {
+            gas = eof ? dispatch_cgoto<false>(cost_table, state, gas, code.data()) :
+                        dispatch_cgoto<true>(cost_table, state, gas, code.data());
+        }
         else
 #endif
-            gas = dispatch<false>(cost_table, state, gas, code.data());
+        {
+            gas = eof ? dispatch<false, false>(cost_table, state, gas, code.data()) :
+                        dispatch<false, true>(cost_table, state, gas, code.data());
+        }
+    }
+
+    if (INTX_UNLIKELY(stats != nullptr))
+    {
+        ++stats->num_executions;
+        stats->peak_memory_size = std::max<uint64_t>(stats->peak_memory_size, state.memory.size());
     }
 
     const auto gas_left = (state.status == EVMC_SUCCESS || state.status == EVMC_REVERT) ? gas : 0;
@@ -361,10 +501,36 @@ evmc_result execute(
     return result;
 }
 
+namespace
+{
+/// Executes like execute() below and additionally counts the host calls and the analysis time.
+[[gnu::noinline]] evmc_result execute_with_stats(const VM& vm, ExecutionStats& stats,
+    const evmc_host_interface& host, evmc_host_context* ctx, evmc_revision rev,
+    const evmc_message& msg, bytes_view code) noexcept
+{
+    if (msg.depth == 0)
+        stats = {};  // The stats are collected per transaction.
+
+    const auto analysis_start = std::chrono::steady_clock::now();
+    const auto jumpdest_map = analyze(rev, code);
+    const auto analysis_time = std::chrono::steady_clock::now() - analysis_start;
+    stats.analysis_time += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(analysis_time).count());
+
+    CountingHost counting_host{host, ctx, stats};
+    auto state = std::make_unique<ExecutionState>(
+        msg, rev, CountingHost::interface, counting_host.context(), code);
+    return execute(vm, msg.gas, *state, jumpdest_map);
+}
+}  // namespace
+
 evmc_result execute(evmc_vm* c_vm, const evmc_host_interface* host, evmc_host_context* ctx,
     evmc_revision rev, const evmc_message* msg, const uint8_t* code, size_t code_size) noexcept
 {
     auto vm = static_cast<VM*>(c_vm);
+    if (auto* const stats = vm->get_stats(); INTX_UNLIKELY(stats != nullptr))
+        return execute_with_stats(*vm, *stats, *host, ctx, rev, *msg, {code, code_size});
+
     const auto jumpdest_map = analyze(rev, {code, code_size});
     auto state =
         std::make_unique<ExecutionState>(*msg, rev, *host, ctx, bytes_view{code, code_size});
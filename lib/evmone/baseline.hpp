@@ -19,14 +19,24 @@ class VM;
 
 namespace baseline
 {
+/// The descriptor of the EOF code section, precomputed for CALLF.
+struct CodeSection
+{
+    const uint8_t* begin;       ///< The first instruction of the code section.
+    uint8_t inputs;             ///< Number of code inputs.
+    uint8_t outputs;            ///< Number of code outputs.
+    uint16_t max_stack_height;  ///< Maximum stack height reached in the code.
+};
+
 class CodeAnalysis
 {
 public:
     using JumpdestMap = std::vector<bool>;
 
-    bytes_view executable_code;  ///< Executable code section.
-    JumpdestMap jumpdest_map;    ///< Map of valid jump destinations.
-    EOF1Header eof_header;       ///< The EOF header.
+    bytes_view executable_code;              ///< Executable code section.
+    JumpdestMap jumpdest_map;                ///< Map of valid jump destinations.
+    EOF1Header eof_header;                   ///< The EOF header.
+    std::vector<CodeSection> code_sections;  ///< The EOF code sections.
 
 private:
     /// Padded code for faster legacy code execution.
@@ -40,8 +50,8 @@ public:
         m_padded_code{std::move(padded_code)}
     {}
 
-    CodeAnalysis(bytes_view code, EOF1Header header)
-      : executable_code{code}, eof_header{std::move(header)}
+    CodeAnalysis(bytes_view code, const EOF1Header& header, std::vector<CodeSection> sections)
+      : executable_code{code}, eof_header{header}, code_sections{std::move(sections)}
     {}
 };
 static_assert(std::is_move_constructible_v<CodeAnalysis>);
@@ -0,0 +1,81 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// The binary execution trace format written by the binary tracer.
+///
+/// The trace file starts with the FileHeader followed by the sequence of fixed-size Records.
+/// The numbers and the stack items are stored in the native byte order of the tracing machine.
+namespace evmone::binary_trace
+{
+/// The number of the top stack items stored in the instruction record.
+constexpr size_t max_stack_items = 4;
+
+/// The trace file header.
+struct FileHeader
+{
+    static constexpr uint8_t expected_magic[8] = {'E', 'V', 'M', 'T', 'R', 'A', 'C', 'E'};
+    static constexpr uint32_t expected_version = 1;
+
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+static_assert(sizeof(FileHeader) == 16);
+
+enum class RecordKind : uint8_t
+{
+    execution_start = 1,
+    instruction = 2,
+    execution_end = 3,
+    output = 4,  ///< The chunk of the output data, follows the execution_end record.
+};
+
+/// The trace record. The meaning of the fields depends on the record kind.
+struct Record
+{
+    RecordKind kind;
+
+    /// instruction: the opcode.
+    uint8_t opcode;
+
+    /// instruction: the number of the stack items stored in the data, the top item first.
+    /// output: the number of the output bytes stored in the data.
+    uint8_t data_size;
+
+    /// execution_start: 1 if the call is static, 0 otherwise.
+    uint8_t is_static;
+
+    /// instruction: the stack height.
+    /// execution_start: the call depth.
+    /// execution_end: the status code.
+    int32_t value;
+
+    /// instruction: the program counter.
+    /// execution_start: the revision.
+    uint32_t pc;
+
+    uint32_t reserved;
+
+    /// instruction: the gas left before the instruction.
+    /// execution_start: the gas limit of the call.
+    /// execution_end: the gas left.
+    int64_t gas;
+
+    /// instruction: the memory size.
+    /// execution_end: the output size.
+    uint64_t size;
+
+    /// instruction: the top stack items as 4 words each, the least significant word first.
+    /// output: the output bytes.
+    uint64_t data[max_stack_items][4];
+};
+static_assert(sizeof(Record) == 160);
+
+/// The max number of the output bytes stored in the output record.
+constexpr size_t max_output_chunk_size = sizeof(Record::data);
+}  // namespace evmone::binary_trace
@@ -0,0 +1,129 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "coverage.hpp"
+#include "instructions_opcodes.hpp"
+#include <ethash/keccak.hpp>
+#include <evmc/hex.hpp>
+#include <bit>
+#include <cstring>
+#include <map>
+#include <new>
+
+namespace evmone
+{
+namespace
+{
+size_t count_bits(const std::vector<uint8_t>& bitmap) noexcept
+{
+    size_t n = 0;
+    for (const auto b : bitmap)
+        n += static_cast<size_t>(std::popcount(b));
+    return n;
+}
+
+/// Builds the bitmap of the basic block starts.
+std::vector<uint8_t> find_block_starts(bytes_view code, const std::vector<bool>& jumpdest_map)
+{
+    std::vector<uint8_t> bitmap((code.size() + 7) / 8);
+    const auto set = [&bitmap](size_t pos) noexcept { bitmap[pos / 8] |= uint8_t(1 << (pos % 8)); };
+
+    if (!code.empty())
+        set(0);
+    for (size_t i = 0; i < code.size(); ++i)
+    {
+        const auto op = code[i];
+        if (jumpdest_map[i])
+            set(i);
+        else if (op == OP_JUMPI && i + 1 < code.size())
+            set(i + 1);
+        else if (op >= OP_PUSH1 && op <= OP_PUSH32)
+            i += static_cast<size_t>(op - OP_PUSH1 + 1);
+    }
+    return bitmap;
+}
+}  // namespace
+
+size_t CodeCoverage::num_blocks() const noexcept
+{
+    return count_bits(block_starts);
+}
+
+size_t CodeCoverage::num_executed_blocks() const noexcept
+{
+    // Skip the bit of the STOP following the code, it is not a block start.
+    size_t n = 0;
+    for (size_t i = 0; i < block_starts.size(); ++i)
+        n += static_cast<size_t>(std::popcount(uint8_t(executed[i] & block_starts[i])));
+    return n;
+}
+
+std::vector<uint32_t> CodeCoverage::unexecuted_blocks() const
+{
+    std::vector<uint32_t> blocks;
+    for (size_t i = 0; i < block_starts.size(); ++i)
+    {
+        auto bits = static_cast<uint8_t>(block_starts[i] & ~executed[i]);
+        for (; bits != 0; bits &= static_cast<uint8_t>(bits - 1))
+        {
+            const auto bit = static_cast<size_t>(std::countr_zero(bits));
+            blocks.push_back(static_cast<uint32_t>(i * 8 + bit));
+        }
+    }
+    return blocks;
+}
+
+uint8_t* Coverage::enter(bytes_view code, const std::vector<bool>& jumpdest_map) noexcept
+{
+    // This file is compiled with exceptions to skip the coverage if the allocation fails
+    // instead of terminating the execution.
+    try
+    {
+        auto& entry = m_addresses[code.data()];
+        if (entry.coverage == nullptr || entry.code != code)
+        {
+            evmc::bytes32 code_hash;
+            const auto h = ethash::keccak256(code.data(), code.size());
+            std::memcpy(code_hash.bytes, h.bytes, sizeof(code_hash.bytes));
+
+            auto& coverage = m_codes[code_hash];
+            if (coverage.executed.empty())
+            {
+                coverage.code_size = code.size();
+                coverage.block_starts = find_block_starts(code, jumpdest_map);
+                coverage.executed.resize(code.size() / 8 + 1);  // Including the bit after the code.
+            }
+            entry.code = code;
+            entry.coverage = &coverage;
+        }
+        return entry.coverage->executed.data();
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+const CodeCoverage* Coverage::find(const evmc::bytes32& code_hash) const noexcept
+{
+    const auto it = m_codes.find(code_hash);
+    return it != m_codes.end() ? &it->second : nullptr;
+}
+
+void Coverage::report(std::ostream& out) const
+{
+    // Sort by code hash for deterministic output.
+    std::map<evmc::bytes32, const CodeCoverage*> sorted;
+    for (const auto& [code_hash, coverage] : m_codes)
+        sorted.emplace(code_hash, &coverage);
+
+    out << "code_hash,code_size,blocks,executed_blocks\n";
+    for (const auto& [code_hash, coverage] : sorted)
+    {
+        out << "0x" << evmc::hex({code_hash.bytes, sizeof(code_hash.bytes)}) << ','
+            << coverage->code_size << ',' << coverage->num_blocks() << ','
+            << coverage->num_executed_blocks() << '\n';
+    }
+}
+}  // namespace evmone
@@ -0,0 +1,91 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <evmc/evmc.hpp>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace evmone
+{
+using bytes = std::basic_string<uint8_t>;
+using bytes_view = std::basic_string_view<uint8_t>;
+
+/// The basic block coverage of a code.
+///
+/// The basic blocks start at the code beginning, at JUMPDESTs and after JUMPIs.
+/// Both bitmaps have a bit per code byte: the bit of the block's first instruction is set.
+struct CodeCoverage
+{
+    size_t code_size = 0;
+    std::vector<uint8_t> block_starts;  ///< The bitmap of the basic block starts.
+    std::vector<uint8_t> executed;      ///< The bitmap of the executed basic blocks.
+
+    /// The number of the basic blocks in the code.
+    [[nodiscard]] size_t num_blocks() const noexcept;
+
+    /// The number of the basic blocks executed at least once.
+    [[nodiscard]] size_t num_executed_blocks() const noexcept;
+
+    /// Returns the offsets of the basic blocks never executed, in order.
+    [[nodiscard]] std::vector<uint32_t> unexecuted_blocks() const;
+};
+
+/// The basic block coverage collector for the legacy code executed by the Baseline interpreter.
+///
+/// Instead of per-instruction tracer callbacks, the interpreter loop sets a bit in the code's
+/// bitmap at every basic block entry, so the coverage is cheap enough for full block replays.
+/// The bitmaps are kept per code hash across all executions until cleared.
+///
+/// enter() inserts the bitmaps of new codes into the map and the interpreter sets the bits
+/// without synchronization, so the executions of a VM collecting coverage must not overlap.
+class Coverage
+{
+    /// The code last entered at the given address and its coverage.
+    struct AddressEntry
+    {
+        bytes code;  ///< The copy of the code: the memory may be reused for another code.
+        CodeCoverage* coverage = nullptr;
+    };
+
+    std::unordered_map<evmc::bytes32, CodeCoverage> m_codes;
+
+    /// The coverage by the code address, so that the code is hashed only when first seen there.
+    std::unordered_map<const uint8_t*, AddressEntry> m_addresses;
+
+public:
+    /// Returns the executed blocks bitmap of the code, for the interpreter to update.
+    /// The bitmap has also the bit for the STOP instruction following the code.
+    ///
+    /// The code is looked up by its address first. The code at a known address is compared
+    /// with its copy instead of being hashed. Returns null if the memory allocation fails,
+    /// the execution then is not covered.
+    ///
+    /// @param code          The legacy code. The original code buffer is expected (it is likely
+    ///                      at the same address in every execution) rather than a copy.
+    /// @param jumpdest_map  The map of valid jump destinations of the code.
+    [[nodiscard]] uint8_t* enter(bytes_view code, const std::vector<bool>& jumpdest_map) noexcept;
+
+    /// Returns the coverage of the code with the given Keccak-256 hash
+    /// or null if such code has not been executed.
+    [[nodiscard]] const CodeCoverage* find(const evmc::bytes32& code_hash) const noexcept;
+
+    /// The number of the executed codes.
+    [[nodiscard]] size_t size() const noexcept { return m_codes.size(); }
+
+    /// Writes the coverage of all codes in CSV format: code_hash,code_size,blocks,executed_blocks.
+    void report(std::ostream& out) const;
+
+    /// Removes the coverage of all codes.
+    void clear() noexcept
+    {
+        m_addresses.clear();
+        m_codes.clear();
+    }
+};
+}  // namespace evmone
@@ -9,9 +9,6 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
-#include <limits>
-#include <numeric>
-#include <stack>
 #include <variant>
 #include <vector>
 
@@ -24,34 +21,35 @@ constexpr uint8_t TERMINATOR = 0x00;
 constexpr uint8_t TYPE_SECTION = 0x01;
 constexpr uint8_t CODE_SECTION = 0x02;
 constexpr uint8_t DATA_SECTION = 0x03;
-constexpr uint8_t MAX_SECTION = DATA_SECTION;
 constexpr auto CODE_SECTION_NUMBER_LIMIT = 1024;
 constexpr auto MAX_STACK_HEIGHT = 0x03FF;
 constexpr auto OUTPUTS_INPUTS_NUMBER_LIMIT = 0x7F;
 constexpr auto REL_OFFSET_SIZE = sizeof(int16_t);
 
-using EOFSectionHeaders = std::array<std::vector<uint16_t>, MAX_SECTION + 1>;
-
-size_t eof_header_size(const EOFSectionHeaders& headers) noexcept
+EOFValidationError get_section_missing_error(uint8_t section_id) noexcept
 {
-    const auto non_code_section_count = 2;  // type section and data section
-    const auto code_section_count = headers[CODE_SECTION].size();
-
-    constexpr auto non_code_section_header_size = 3;  // (SECTION_ID + SIZE) per each section
-    constexpr auto code_section_size_size = 2;
+    return static_cast<EOFValidationError>(
+        static_cast<uint8_t>(EOFValidationError::header_terminator_missing) + section_id);
+}
 
-    return sizeof(MAGIC) + 1 +  // 1 version byte
-           non_code_section_count * non_code_section_header_size + sizeof(CODE_SECTION) + 2 +
-           code_section_count * code_section_size_size + sizeof(TERMINATOR);
+/// Sets the offset of the next code section in the header.
+/// Only the offsets of the first EOF1Header::max_inline_code_sections sections are stored.
+inline void set_code_offset(EOF1Header& header, size_t code_idx, size_t offset) noexcept
+{
+    if (code_idx < EOF1Header::max_inline_code_sections)
+        header.code_offsets[code_idx] = static_cast<uint32_t>(offset);
 }
 
-EOFValidationError get_section_missing_error(uint8_t section_id) noexcept
+/// Sets the section offsets in the header once the header size is known.
+inline void set_section_offsets(
+    EOF1Header& header, size_t header_size, size_t types_size, size_t code_size) noexcept
 {
-    return static_cast<EOFValidationError>(
-        static_cast<uint8_t>(EOFValidationError::header_terminator_missing) + section_id);
+    header.types_offset = static_cast<uint32_t>(header_size);
+    header.code_sections_offset = static_cast<uint32_t>(header_size + types_size);
+    header.data_offset = static_cast<uint32_t>(header_size + types_size + code_size);
 }
 
-std::variant<EOFSectionHeaders, EOFValidationError> validate_eof_headers(bytes_view container)
+std::variant<EOF1Header, EOFValidationError> validate_eof_headers(bytes_view container) noexcept
 {
     enum class State
     {
@@ -63,7 +61,10 @@ std::variant<EOFSectionHeaders, EOFValidationError> validate_eof_headers(bytes_v
     auto state = State::section_id;
     uint8_t section_id = 0;
     uint16_t section_num = 0;
-    EOFSectionHeaders section_headers{};
+    EOF1Header header;
+    header.version = container[2];
+    size_t types_size = 0;
+    size_t code_size = 0;  // The total size of all code sections.
     const auto container_end = container.end();
     auto it = container.begin() + std::size(MAGIC) + 1;  // MAGIC + VERSION
     uint8_t expected_section_id = TYPE_SECTION;
@@ -124,8 +125,10 @@ std::variant<EOFSectionHeaders, EOFValidationError> validate_eof_headers(bytes_v
                     if (section_size == 0)
                         return EOFValidationError::zero_section_size;
 
-                    section_headers[section_id].emplace_back(section_size);
+                    set_code_offset(header, i, code_size);
+                    code_size += section_size;
                 }
+                header.num_code_sections = section_num;
             }
             else  // TYPES_SECTION or DATA_SECTION
             {
@@ -136,7 +139,10 @@ std::variant<EOFSectionHeaders, EOFValidationError> validate_eof_headers(bytes_v
                 if (section_size == 0 && section_id != DATA_SECTION)
                     return EOFValidationError::zero_section_size;
 
-                section_headers[section_id].emplace_back(section_size);
+                if (section_id == TYPE_SECTION)
+                    types_size = section_size;
+                else
+                    header.data_size = section_size;
             }
 
             state = State::section_id;
@@ -150,42 +156,29 @@ std::variant<EOFSectionHeaders, EOFValidationError> validate_eof_headers(bytes_v
     if (state != State::terminated)
         return EOFValidationError::section_headers_not_terminated;
 
-    const auto section_bodies_size = section_headers[TYPE_SECTION].front() +
-                                     std::accumulate(section_headers[CODE_SECTION].begin(),
-                                         section_headers[CODE_SECTION].end(), 0) +
-                                     section_headers[DATA_SECTION].front();
-    const auto remaining_container_size = container_end - it;
+    const auto section_bodies_size = types_size + code_size + header.data_size;
+    const auto remaining_container_size = static_cast<size_t>(container_end - it);
     if (section_bodies_size != remaining_container_size)
         return EOFValidationError::invalid_section_bodies_size;
 
-    if (section_headers[TYPE_SECTION][0] != section_headers[CODE_SECTION].size() * 4)
+    if (types_size != size_t{header.num_code_sections} * 4)
         return EOFValidationError::invalid_type_section_size;
 
-    return section_headers;
+    set_section_offsets(
+        header, static_cast<size_t>(it - container.begin()), types_size, code_size);
+    return header;
 }
 
-std::variant<std::vector<EOFCodeType>, EOFValidationError> validate_types(
-    bytes_view container, size_t header_size, uint16_t type_section_size) noexcept
+EOFValidationError validate_types(bytes_view container, const EOF1Header& header) noexcept
 {
-    assert(!container.empty());  // guaranteed by EOF headers validation
-
-    std::vector<EOFCodeType> types;
-
-    // guaranteed by EOF headers validation
-    assert(header_size + type_section_size < container.size());
-
-    for (auto offset = header_size; offset < header_size + type_section_size; offset += 4)
-    {
-        types.emplace_back(
-            container[offset], container[offset + 1], read_uint16_be(&container[offset + 2]));
-    }
-
     // check 1st section is (0, 0)
-    if (types[0].inputs != 0 || types[0].outputs != 0)
+    const auto first_type = header.get_type(container, 0);
+    if (first_type.inputs != 0 || first_type.outputs != 0)
         return EOFValidationError::invalid_first_section_type;
 
-    for (const auto& t : types)
+    for (size_t i = 0; i < header.num_code_sections; ++i)
     {
+        const auto t = header.get_type(container, i);
         if (t.outputs > OUTPUTS_INPUTS_NUMBER_LIMIT || t.inputs > OUTPUTS_INPUTS_NUMBER_LIMIT)
             return EOFValidationError::inputs_outputs_num_above_limit;
 
@@ -193,21 +186,62 @@ std::variant<std::vector<EOFCodeType>, EOFValidationError> validate_types(
             return EOFValidationError::max_stack_height_above_limit;
     }
 
-    return types;
+    return EOFValidationError::success;
 }
 
-EOFValidationError validate_instructions(evmc_revision rev, bytes_view code) noexcept
+/// The scratch buffers of the code section validation.
+/// They are reused by all validations performed by a thread so these allocate memory only
+/// when a code section bigger than any seen before is validated.
+struct ValidationScratch
 {
+    /// The stack height before each instruction or one of the LOC_* special values.
+    std::vector<int32_t> stack_heights;
+
+    /// The relative jump destinations.
+    std::vector<size_t> rjumpdests;
+
+    /// The offsets of the instructions to visit in the stack height validation.
+    std::vector<size_t> worklist;
+};
+
+/// Validates the code section and computes its max stack height.
+///
+/// The instructions are decoded in a single linear pass which checks the instructions,
+/// marks the immediate bytes and collects the relative jump destinations. Then the stack
+/// heights are computed by traversing the control flow of the section.
+/// The errors are reported with the precedence of separate passes: the instructions,
+/// the relative jump destinations and the stack heights.
+std::variant<EOFValidationError, int32_t> validate_code_section(evmc_revision rev,
+    bytes_view container, const EOF1Header& header, size_t func_index, bytes_view code) noexcept
+{
+    const auto func_type = header.get_type(container, func_index);
     assert(!code.empty());  // guaranteed by EOF headers validation
 
+    // Special values used for detecting errors.
+    static constexpr int32_t LOC_UNVISITED = -1;  // Unvisited byte.
+    static constexpr int32_t LOC_IMMEDIATE = -2;  // Immediate byte.
+
+    thread_local ValidationScratch scratch;
+    // Stack height in the header is limited to uint16_t,
+    // but keeping larger size for ease of calculation.
+    auto& stack_heights = scratch.stack_heights;
+    auto& rjumpdests = scratch.rjumpdests;
+    auto& worklist = scratch.worklist;
+    stack_heights.assign(code.size(), LOC_UNVISITED);
+    rjumpdests.clear();
+    worklist.clear();
+
     const auto& cost_table = baseline::get_baseline_cost_table(rev, 1);
 
+    auto rjumpdests_in_range = true;
+    size_t num_instructions = 0;
     for (size_t i = 0; i < code.size(); ++i)
     {
         const auto op = code[i];
         if (cost_table[op] == instr::undefined)
             return EOFValidationError::undefined_instruction;
 
+        size_t imm_size = instr::traits[op].immediate_size;
         if (op == OP_RJUMPV)
         {
             if (i + 1 >= code.size())
@@ -216,98 +250,72 @@ EOFValidationError validate_instructions(evmc_revision rev, bytes_view code) noe
             const auto count = code[i + 1];
             if (count < 1)
                 return EOFValidationError::invalid_rjumpv_count;
-            i += static_cast<size_t>(1 /* count */ + count * 2 /* tbl */);
+            imm_size = size_t{1} /* count */ + count * REL_OFFSET_SIZE /* tbl */;
         }
-        else
-            i += instr::traits[op].immediate_size;
 
-        if (i >= code.size())
+        if (i + imm_size >= code.size())
             return EOFValidationError::truncated_instruction;
-    }
-
-    return EOFValidationError::success;
-}
 
-/// Validates that that we don't rjump inside an instruction's immediate.
-/// Requires that the input is validated against truncation.
-bool validate_rjump_destinations(bytes_view code) noexcept
-{
-    // Collect relative jump destinations and immediate locations
-    const auto code_size = code.size();
-    // list of all possible absolute rjumps destinations positions
-    std::vector<size_t> rjumpdests;
-    // bool map of immediate arguments positions in the code
-    std::vector<bool> immediate_map(code_size);
-
-    /// Validates relative jump destination. If valid pushes the destination to the rjumpdests.
-    const auto check_rjump_destination = [code_size, &rjumpdests](
-                                             auto rel_offset_data_it, size_t post_pos) -> bool {
-        const auto rel_offset = read_int16_be(rel_offset_data_it);
-        const auto jumpdest = static_cast<int32_t>(post_pos) + rel_offset;
-        if (jumpdest < 0 || static_cast<size_t>(jumpdest) >= code_size)
-            return false;
-
-        rjumpdests.emplace_back(static_cast<size_t>(jumpdest));
-        return true;
-    };
+        ++num_instructions;
 
-    for (size_t i = 0; i < code_size; ++i)
-    {
-        const auto op = code[i];
-        size_t imm_size = instr::traits[op].immediate_size;
+        // Collects the relative jump destination if it is within the code.
+        const auto post_pos = i + 1 + imm_size;
+        const auto add_rjumpdest = [&](size_t rel_offset_pos) noexcept {
+            const auto rel_offset = read_int16_be(&code[rel_offset_pos]);
+            const auto jumpdest = static_cast<int32_t>(post_pos) + rel_offset;
+            if (jumpdest < 0 || static_cast<size_t>(jumpdest) >= code.size())
+                rjumpdests_in_range = false;
+            else
+                rjumpdests.emplace_back(static_cast<size_t>(jumpdest));
+        };
 
         if (op == OP_RJUMP || op == OP_RJUMPI)
-        {
-            if (!check_rjump_destination(&code[i + 1], i + REL_OFFSET_SIZE + 1))
-                return false;
-        }
+            add_rjumpdest(i + 1);
         else if (op == OP_RJUMPV)
         {
-            const auto count = code[i + 1];
-            imm_size += size_t{1} /* count */ + count * REL_OFFSET_SIZE /* tbl */;
-            const size_t post_pos = i + 1 + imm_size;
-
-            for (size_t k = 0; k < count * REL_OFFSET_SIZE; k += REL_OFFSET_SIZE)
-            {
-                if (!check_rjump_destination(&code[i + 1 + 1 + static_cast<uint16_t>(k)], post_pos))
-                    return false;
-            }
+            for (size_t k = 0; k < code[i + 1]; ++k)
+                add_rjumpdest(i + 2 + k * REL_OFFSET_SIZE);
         }
 
-        std::fill_n(immediate_map.begin() + static_cast<ptrdiff_t>(i) + 1, imm_size, true);
+        // Mark immediate locations.
+        std::fill_n(&stack_heights[i + 1], imm_size, LOC_IMMEDIATE);
         i += imm_size;
     }
 
     // Check relative jump destinations against immediate locations.
+    if (!rjumpdests_in_range)
+        return EOFValidationError::invalid_rjump_destination;
     for (const auto rjumpdest : rjumpdests)
-        if (immediate_map[rjumpdest])
-            return false;
-
-    return true;
-}
-
-/// Requires that the input is validated against truncation.
-std::variant<EOFValidationError, int32_t> validate_max_stack_height(
-    bytes_view code, size_t func_index, const std::vector<EOFCodeType>& code_types)
-{
-    assert(!code.empty());
-
-    // Special values used for detecting errors.
-    static constexpr int32_t LOC_UNVISITED = -1;  // Unvisited byte.
-    static constexpr int32_t LOC_IMMEDIATE = -2;  // Immediate byte.
+    {
+        if (stack_heights[rjumpdest] == LOC_IMMEDIATE)
+            return EOFValidationError::invalid_rjump_destination;
+    }
 
-    // Stack height in the header is limited to uint16_t,
-    // but keeping larger size for ease of calculation.
-    std::vector<int32_t> stack_heights(code.size(), LOC_UNVISITED);
-    stack_heights[0] = code_types[func_index].inputs;
+    stack_heights[0] = func_type.inputs;
+    worklist.emplace_back(0);
+    auto max_stack_height = stack_heights[0];
+    size_t num_visited = 1;
 
-    std::stack<size_t> worklist;
-    worklist.push(0);
+    // Validates the successor instruction and updates its stack height.
+    const auto validate_successor = [&](size_t successor_offset,
+                                        int32_t expected_stack_height) noexcept {
+        auto& successor_stack_height = stack_heights[successor_offset];
+        if (successor_stack_height == LOC_UNVISITED)
+        {
+            successor_stack_height = expected_stack_height;
+            max_stack_height = std::max(max_stack_height, expected_stack_height);
+            ++num_visited;
+            worklist.emplace_back(successor_offset);
+            return true;
+        }
+        else
+            return successor_stack_height == expected_stack_height;
+    };
 
     while (!worklist.empty())
     {
-        const auto i = worklist.top();
-        worklist.pop();
+        const auto i = worklist.back();
+        worklist.pop_back();
 
         const auto opcode = static_cast<Opcode>(code[i]);
 
@@ -318,12 +326,12 @@ std::variant<EOFValidationError, int32_t> validate_max_stack_height(
         {
             const auto fid = read_uint16_be(&code[i + 1]);
 
-            if (fid >= code_types.size())
+            if (fid >= header.num_code_sections)
                 return EOFValidationError::invalid_code_section_index;
 
-            stack_height_required = static_cast<int8_t>(code_types[fid].inputs);
-            stack_height_change =
-                static_cast<int8_t>(code_types[fid].outputs - stack_height_required);
+            const auto fid_type = header.get_type(container, fid);
+            stack_height_required = static_cast<int8_t>(fid_type.inputs);
+            stack_height_change = static_cast<int8_t>(fid_type.outputs - stack_height_required);
         }
 
         auto stack_height = stack_heights[i];
@@ -339,23 +347,6 @@ std::variant<EOFValidationError, int32_t> validate_max_stack_height(
                                     (1 + /*count*/ size_t{code[i + 1]} * REL_OFFSET_SIZE) :
                                     instr::traits[opcode].immediate_size;
 
-        // Mark immediate locations.
-        std::fill_n(&stack_heights[i + 1], imm_size, LOC_IMMEDIATE);
-
-        // Validates the successor instruction and updates its stack height.
-        const auto validate_successor = [&stack_heights, &worklist](size_t successor_offset,
-                                            int32_t expected_stack_height) {
-            auto& successor_stack_height = stack_heights[successor_offset];
-            if (successor_stack_height == LOC_UNVISITED)
-            {
-                successor_stack_height = expected_stack_height;
-                worklist.push(successor_offset);
-                return true;
-            }
-            else
-                return successor_stack_height == expected_stack_height;
-        };
-
         const auto next = i + imm_size + 1;  // Offset of the next instruction (may be invalid).
 
         // Check validity of next instruction. We skip RJUMP and terminating instructions.
@@ -388,13 +379,12 @@ std::variant<EOFValidationError, int32_t> validate_max_stack_height(
                     return EOFValidationError::stack_height_mismatch;
             }
         }
-        else if (opcode == OP_RETF && stack_height != code_types[func_index].outputs)
+        else if (opcode == OP_RETF && stack_height != func_type.outputs)
             return EOFValidationError::non_empty_stack_on_terminating_instruction;
     }
 
-    const auto max_stack_height = *std::max_element(stack_heights.begin(), stack_heights.end());
-
-    if (std::find(stack_heights.begin(), stack_heights.end(), LOC_UNVISITED) != stack_heights.end())
+    // All instructions must be visited.
+    if (num_visited != num_instructions)
         return EOFValidationError::unreachable_instructions;
 
     return max_stack_height;
@@ -403,48 +393,25 @@ std::variant<EOFValidationError, int32_t> validate_max_stack_height(
 std::variant<EOF1Header, EOFValidationError> validate_eof1(
     evmc_revision rev, bytes_view container) noexcept
 {
-    const auto section_headers_or_error = validate_eof_headers(container);
-    if (const auto* error = std::get_if<EOFValidationError>(&section_headers_or_error))
+    const auto header_or_error = validate_eof_headers(container);
+    if (const auto* error = std::get_if<EOFValidationError>(&header_or_error))
         return *error;
 
-    const auto& section_headers = std::get<EOFSectionHeaders>(section_headers_or_error);
-    const auto& code_sizes = section_headers[CODE_SECTION];
-    const auto data_size = section_headers[DATA_SECTION][0];
-
-    const auto header_size = eof_header_size(section_headers);
-
-    const auto types_or_error =
-        validate_types(container, header_size, section_headers[TYPE_SECTION].front());
-    if (const auto* error = std::get_if<EOFValidationError>(&types_or_error))
-        return *error;
-    const auto& types = std::get<std::vector<EOFCodeType>>(types_or_error);
-
-    std::vector<uint16_t> code_offsets;
-    const auto type_section_size = section_headers[TYPE_SECTION][0];
-    auto offset = header_size + type_section_size;
-    for (const auto code_size : code_sizes)
-    {
-        assert(offset <= std::numeric_limits<uint16_t>::max());
-        code_offsets.emplace_back(static_cast<uint16_t>(offset));
-        offset += code_size;
-    }
+    const auto& header = std::get<EOF1Header>(header_or_error);
 
-    EOF1Header header{container[2], code_sizes, code_offsets, data_size, types};
+    if (const auto error = validate_types(container, header); error != EOFValidationError::success)
+        return error;
 
-    for (size_t code_idx = 0; code_idx < header.code_sizes.size(); ++code_idx)
+    auto code_pos = size_t{header.code_sections_offset};
+    for (size_t code_idx = 0; code_idx < header.num_code_sections; ++code_idx)
     {
-        const auto error_instr = validate_instructions(rev, header.get_code(container, code_idx));
-        if (error_instr != EOFValidationError::success)
-            return error_instr;
-
-        if (!validate_rjump_destinations(header.get_code(container, code_idx)))
-            return EOFValidationError::invalid_rjump_destination;
-
-        auto msh_or_error =
-            validate_max_stack_height(header.get_code(container, code_idx), code_idx, header.types);
+        const auto code = container.substr(code_pos, header.get_code_size(container, code_idx));
+        code_pos += code.size();
+        const auto msh_or_error = validate_code_section(rev, container, header, code_idx, code);
         if (const auto* error = std::get_if<EOFValidationError>(&msh_or_error))
             return *error;
-        if (std::get<int32_t>(msh_or_error) != header.types[code_idx].max_stack_height)
+        if (std::get<int32_t>(msh_or_error) !=
+            header.get_type(container, code_idx).max_stack_height)
             return EOFValidationError::invalid_max_stack_height;
     }
 
@@ -459,55 +426,41 @@ bool is_eof_container(bytes_view container) noexcept
 }
 
 /// This function expects the prefix and version to be valid, as it ignores it.
-EOF1Header read_valid_eof1_header(bytes_view container)
+EOF1Header read_valid_eof1_header(bytes_view container) noexcept
 {
-    EOFSectionHeaders section_headers;
+    EOF1Header header;
+    header.version = container[2];
+    size_t types_size = 0;
+    size_t code_size = 0;  // The total size of all code sections.
     auto it = container.begin() + std::size(MAGIC) + 1;  // MAGIC + VERSION
     while (*it != TERMINATOR)
     {
         const auto section_id = *it++;
         if (section_id == CODE_SECTION)
         {
-            const auto code_section_num = read_uint16_be(it);
+            header.num_code_sections = read_uint16_be(it);
             it += 2;
-            for (uint16_t i = 0; i < code_section_num; ++i)
+            for (size_t i = 0; i < header.num_code_sections; ++i)
             {
-                const auto section_size = read_uint16_be(it);
+                set_code_offset(header, i, code_size);
+                code_size += read_uint16_be(it);
                 it += 2;
-                section_headers[section_id].emplace_back(section_size);
             }
         }
         else
         {
             const auto section_size = read_uint16_be(it);
             it += 2;
-            section_headers[section_id].emplace_back(section_size);
+            if (section_id == TYPE_SECTION)
+                types_size = section_size;
+            else
+                header.data_size = section_size;
         }
     }
-    const auto header_size = eof_header_size(section_headers);
-
-    EOF1Header header;
-
-    header.version = container[2];
-
-    for (auto type_offset = header_size;
-         type_offset < header_size + section_headers[TYPE_SECTION][0]; type_offset += 4)
-    {
-        header.types.emplace_back(container[type_offset], container[type_offset + 1],
-            read_uint16_be(&container[type_offset + 2]));
-    }
-
-    header.code_sizes = section_headers[CODE_SECTION];
-    auto code_offset = header_size + section_headers[TYPE_SECTION][0];
-    for (const auto code_size : header.code_sizes)
-    {
-        assert(code_offset <= std::numeric_limits<uint16_t>::max());
-        header.code_offsets.emplace_back(static_cast<uint16_t>(code_offset));
-        code_offset += code_size;
-    }
-
-    header.data_size = section_headers[DATA_SECTION][0];
+    ++it;  // TERMINATOR
 
+    set_section_offsets(
+        header, static_cast<size_t>(it - container.begin()), types_size, code_size);
     return header;
 }
 
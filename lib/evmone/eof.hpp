@@ -9,12 +9,32 @@
 #include <cstddef>
 #include <cstdint>
 #include <string>
-#include <vector>
+#include <type_traits>
 
 namespace evmone
 {
 using bytes_view = std::basic_string_view<uint8_t>;
 
+/// Loads big endian int16_t from data. Unsafe.
+/// TODO: Move it to intx
+template <class T>
+inline int16_t read_int16_be(T it) noexcept
+{
+    const uint8_t h = *it++;
+    const uint8_t l = *it;
+    return static_cast<int16_t>((h << 8) | l);
+}
+
+/// Loads big endian uint16_t from data. Unsafe.
+/// TODO: Move it to intx
+template <class T>
+inline uint16_t read_uint16_be(T it) noexcept
+{
+    const uint8_t h = *it++;
+    const uint8_t l = *it;
+    return static_cast<uint16_t>((h << 8) | l);
+}
+
 struct EOFCodeType
 {
     uint8_t inputs;             ///< Number of code inputs.
@@ -26,35 +46,92 @@ struct EOFCodeType
     {}
 };
 
+/// The EOF1 container header.
+///
+/// The header is trivially copyable and does not allocate: the code section sizes and types are
+/// read from the container bytes, therefore all accessors require the container the header has
+/// been read from. The offsets of the first max_inline_code_sections code sections are stored
+/// inline, the offsets of the following ones are computed from the code section sizes.
 struct EOF1Header
 {
+    /// The number of code sections having their offsets stored in the header.
+    static constexpr size_t max_inline_code_sections = 16;
+
+    /// The offset of the first code section size in the container.
+    static constexpr size_t code_sizes_offset = 9;
+
     /// The EOF version, 0 means legacy code.
     uint8_t version = 0;
 
-    /// Size of every code section.
-    std::vector<uint16_t> code_sizes;
-
-    /// Offset of every code section from the beginning of the EOF container.
-    std::vector<uint16_t> code_offsets;
+    /// The number of code sections.
+    uint16_t num_code_sections = 0;
 
     uint16_t data_size = 0;
 
-    std::vector<EOFCodeType> types;
+    /// Offset of the type section from the beginning of the EOF container.
+    uint32_t types_offset = 0;
+
+    /// Offset of the first code section from the beginning of the EOF container.
+    uint32_t code_sections_offset = 0;
+
+    /// Offset of the data section from the beginning of the EOF container.
+    uint32_t data_offset = 0;
+
+    /// Offsets of the first code sections relative to the code_sections_offset.
+    uint32_t code_offsets[max_inline_code_sections]{};
+
+    /// Returns the size of the code section.
+    [[nodiscard]] uint16_t get_code_size(bytes_view container, size_t code_idx) const noexcept
+    {
+        assert(code_idx < num_code_sections);
+        return read_uint16_be(&container[code_sizes_offset + code_idx * 2]);
+    }
+
+    /// Returns the offset of the code section relative to the code_sections_offset.
+    ///
+    /// The offsets of the sections past the inline ones are computed by summing the sizes of
+    /// the preceding sections. The loops over all code sections should track the offset instead.
+    [[nodiscard]] uint32_t get_code_offset(bytes_view container, size_t code_idx) const noexcept
+    {
+        assert(code_idx < num_code_sections);
+        if (code_idx < max_inline_code_sections)
+            return code_offsets[code_idx];
+
+        auto offset = code_offsets[max_inline_code_sections - 1];
+        for (auto i = max_inline_code_sections - 1; i < code_idx; ++i)
+            offset += get_code_size(container, i);
+        return offset;
+    }
+
+    /// Returns the type of the code section.
+    [[nodiscard]] EOFCodeType get_type(bytes_view container, size_t code_idx) const noexcept
+    {
+        assert(code_idx < num_code_sections);
+        const auto t = &container[types_offset + code_idx * 4];
+        return {t[0], t[1], read_uint16_be(&t[2])};
+    }
 
     /// A helper to extract reference to a specific code section.
     [[nodiscard]] bytes_view get_code(bytes_view container, size_t code_idx) const noexcept
     {
-        assert(code_idx < code_offsets.size());
-        return container.substr(code_offsets[code_idx], code_sizes[code_idx]);
+        return container.substr(code_sections_offset + get_code_offset(container, code_idx),
+            get_code_size(container, code_idx));
+    }
+
+    /// A helper to extract reference to all code sections as single buffer.
+    [[nodiscard]] bytes_view get_code_sections(bytes_view container) const noexcept
+    {
+        return container.substr(code_sections_offset, data_offset - code_sections_offset);
     }
 };
+static_assert(std::is_trivially_copyable_v<EOF1Header>);
 
 /// Checks if code starts with EOF FORMAT + MAGIC, doesn't validate the format.
 [[nodiscard]] EVMC_EXPORT bool is_eof_container(bytes_view code) noexcept;
 
 /// Reads the section sizes assuming that container has valid format.
 /// (must be true for all EOF contracts on-chain)
-[[nodiscard]] EVMC_EXPORT EOF1Header read_valid_eof1_header(bytes_view container);
+[[nodiscard]] EVMC_EXPORT EOF1Header read_valid_eof1_header(bytes_view container) noexcept;
 
 enum class EOFValidationError
 {
@@ -104,24 +181,4 @@ enum class EOFValidationError
 /// Returns the error message corresponding to an error code.
 [[nodiscard]] EVMC_EXPORT std::string_view get_error_message(EOFValidationError err) noexcept;
 
-/// Loads big endian int16_t from data. Unsafe.
-/// TODO: Move it to intx
-template <class T>
-inline int16_t read_int16_be(T it) noexcept
-{
-    const uint8_t h = *it++;
-    const uint8_t l = *it;
-    return static_cast<int16_t>((h << 8) | l);
-}
-
-/// Loads big endian uint16_t from data. Unsafe.
-/// TODO: Move it to intx
-template <class T>
-inline uint16_t read_uint16_be(T it) noexcept
-{
-    const uint8_t h = *it++;
-    const uint8_t l = *it;
-    return static_cast<uint16_t>((h << 8) | l);
-}
-
 }  // namespace evmone
@@ -0,0 +1,81 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "eof_validation_cache.hpp"
+#include <ethash/keccak.hpp>
+#include <cstring>
+#include <exception>
+
+namespace evmone
+{
+EOFValidationError EOFValidationCache::validate(evmc_revision rev, bytes_view container) noexcept
+{
+    Key key{{}, rev};
+    const auto h = ethash::keccak256(container.data(), container.size());
+    std::memcpy(key.hash.bytes, h.bytes, sizeof(key.hash.bytes));
+
+    try
+    {
+        const std::lock_guard lock{m_mutex};
+        if (const auto it = m_results.find(key); it != m_results.end())
+        {
+            ++m_hits;
+            return it->second;
+        }
+        ++m_misses;
+    }
+    catch (const std::exception&)
+    {
+        // The mutex cannot be locked: validate without the cache.
+        return validate_eof(rev, container);
+    }
+
+    // Validate without holding the lock. Concurrent validations of the same container
+    // produce the same result.
+    const auto result = validate_eof(rev, container);
+
+    try
+    {
+        const std::lock_guard lock{m_mutex};
+        if (m_results.size() >= max_entries)
+            m_results.clear();
+        m_results.emplace(key, result);
+    }
+    catch (const std::exception&)
+    {
+        // The result is not cached if the mutex cannot be locked or the entry allocated.
+    }
+    return result;
+}
+
+void EOFValidationCache::clear() noexcept
+{
+    const std::lock_guard lock{m_mutex};
+    m_results.clear();
+}
+
+size_t EOFValidationCache::size() const noexcept
+{
+    const std::lock_guard lock{m_mutex};
+    return m_results.size();
+}
+
+uint64_t EOFValidationCache::hits() const noexcept
+{
+    const std::lock_guard lock{m_mutex};
+    return m_hits;
+}
+
+uint64_t EOFValidationCache::misses() const noexcept
+{
+    const std::lock_guard lock{m_mutex};
+    return m_misses;
+}
+
+EOFValidationError validate_eof_cached(evmc_revision rev, bytes_view container) noexcept
+{
+    static EOFValidationCache cache;
+    return cache.validate(rev, container);
+}
+}  // namespace evmone
@@ -0,0 +1,70 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include "eof.hpp"
+#include <evmc/evmc.hpp>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace evmone
+{
+/// Cache of EOF validation results keyed by the Keccak-256 hash of the container.
+///
+/// The same container is often validated many times: factory contracts deploy the same code
+/// repeatedly and the state tests validate the same pre-state for every test case.
+/// Hashing the container is much cheaper than validating it.
+///
+/// The cache is thread-safe. Its size is bounded by max_entries: when full, it is cleared.
+class EOFValidationCache
+{
+public:
+    /// The maximum number of cached results.
+    static constexpr size_t max_entries = 4096;
+
+private:
+    struct Key
+    {
+        evmc::bytes32 hash;
+        evmc_revision rev;
+
+        friend bool operator==(const Key&, const Key&) noexcept = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const noexcept
+        {
+            return std::hash<evmc::bytes32>{}(key.hash) ^ static_cast<size_t>(key.rev);
+        }
+    };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<Key, EOFValidationError, KeyHash> m_results;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+
+public:
+    /// Validates the container like validate_eof() unless the result is already cached.
+    /// If the cache cannot be locked or extended, the result is not cached.
+    [[nodiscard]] EOFValidationError validate(evmc_revision rev, bytes_view container) noexcept;
+
+    /// Removes all cached results. The hit/miss counters are not reset.
+    void clear() noexcept;
+
+    /// The number of cached results.
+    [[nodiscard]] size_t size() const noexcept;
+
+    /// The number of validate() calls served from the cache.
+    [[nodiscard]] uint64_t hits() const noexcept;
+
+    /// The number of validate() calls which validated the container.
+    [[nodiscard]] uint64_t misses() const noexcept;
+};
+
+/// Validates the container using the process-wide EOFValidationCache.
+[[nodiscard]] EVMC_EXPORT EOFValidationError validate_eof_cached(
+    evmc_revision rev, bytes_view container) noexcept;
+}  // namespace evmone
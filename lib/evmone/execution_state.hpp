@@ -5,6 +5,7 @@
 
 #include <evmc/evmc.hpp>
 #include <intx/intx.hpp>
+#include <cassert>
 #include <string>
 #include <vector>
 
@@ -18,6 +19,7 @@ namespace baseline
 {
 class CodeAnalysis;
 }
+class KeccakCache;
 
 using uint256 = intx::uint256;
 using bytes = std::basic_string<uint8_t>;
@@ -44,6 +46,49 @@ private:
 };
 
 
+/// The return stack of EOF functions, i.e. the return addresses of the CALLF instructions.
+///
+/// The storage for the maximum number of nested calls is allocated in place so pushing
+/// to the stack never allocates.
+template <typename T>
+class ReturnStack
+{
+public:
+    /// The maximum number of return addresses.
+    static constexpr size_t limit = 1024;
+
+    /// Creates the empty stack leaving the storage uninitialized.
+    // NOLINTNEXTLINE(modernize-use-equals-default)
+    ReturnStack() noexcept {}
+
+    /// The number of return addresses on the stack.
+    [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+    /// Checks if the stack has no space for another return address.
+    [[nodiscard]] bool full() const noexcept { return m_size == limit; }
+
+    /// Pushes the return address. The stack must not be full.
+    void push(T item) noexcept
+    {
+        assert(m_size < limit);
+        m_items[m_size++] = item;
+    }
+
+    /// Pops the return address. The stack must not be empty.
+    T pop() noexcept
+    {
+        assert(m_size != 0);
+        return m_items[--m_size];
+    }
+
+    void clear() noexcept { m_size = 0; }
+
+private:
+    size_t m_size = 0;
+    T m_items[limit];
+};
+
+
 /// The EVM memory.
 ///
 /// The implementations uses initial allocation of 4k and then grows capacity with 2x factor.
@@ -151,7 +196,14 @@ public:
         const advanced::AdvancedCodeAnalysis* advanced;
     } analysis{};
 
-    std::vector<const uint8_t*> call_stack;
+    /// The return addresses of the EOF CALLF instructions.
+    ///
+    /// The interpreters store their own kind of the return address:
+    /// the code position in Baseline and the instruction pointer in Advanced.
+    ReturnStack<const void*> call_stack;
+
+    /// The optional cache for KECCAK256 of small inputs. Null if disabled.
+    KeccakCache* keccak_cache = nullptr;
 
     /// Stack space allocation.
     ///
@@ -182,6 +234,7 @@ public:
         output_offset = 0;
         output_size = 0;
         m_tx = {};
+        call_stack.clear();
     }
 
     [[nodiscard]] bool in_static_mode() const { return (msg->flags & EVMC_STATIC) != 0; }
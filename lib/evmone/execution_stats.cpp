@@ -0,0 +1,118 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "execution_stats.hpp"
+
+namespace evmone
+{
+namespace
+{
+bool account_exists(evmc_host_context* ctx, const evmc_address* addr) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::account_exists);
+    return h.host().account_exists(h.host_context(), addr);
+}
+
+evmc_bytes32 get_storage(
+    evmc_host_context* ctx, const evmc_address* addr, const evmc_bytes32* key) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::get_storage);
+    return h.host().get_storage(h.host_context(), addr, key);
+}
+
+evmc_storage_status set_storage(evmc_host_context* ctx, const evmc_address* addr,
+    const evmc_bytes32* key, const evmc_bytes32* value) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::set_storage);
+    return h.host().set_storage(h.host_context(), addr, key, value);
+}
+
+evmc_uint256be get_balance(evmc_host_context* ctx, const evmc_address* addr) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::get_balance);
+    return h.host().get_balance(h.host_context(), addr);
+}
+
+size_t get_code_size(evmc_host_context* ctx, const evmc_address* addr) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::get_code_size);
+    return h.host().get_code_size(h.host_context(), addr);
+}
+
+evmc_bytes32 get_code_hash(evmc_host_context* ctx, const evmc_address* addr) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::get_code_hash);
+    return h.host().get_code_hash(h.host_context(), addr);
+}
+
+size_t copy_code(evmc_host_context* ctx, const evmc_address* addr, size_t code_offset,
+    uint8_t* buffer_data, size_t buffer_size) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::copy_code);
+    return h.host().copy_code(h.host_context(), addr, code_offset, buffer_data, buffer_size);
+}
+
+bool selfdestruct(
+    evmc_host_context* ctx, const evmc_address* addr, const evmc_address* beneficiary) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::selfdestruct);
+    return h.host().selfdestruct(h.host_context(), addr, beneficiary);
+}
+
+evmc_result call(evmc_host_context* ctx, const evmc_message* msg) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::call);
+    return h.host().call(h.host_context(), msg);
+}
+
+evmc_tx_context get_tx_context(evmc_host_context* ctx) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::get_tx_context);
+    return h.host().get_tx_context(h.host_context());
+}
+
+evmc_bytes32 get_block_hash(evmc_host_context* ctx, int64_t number) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::get_block_hash);
+    return h.host().get_block_hash(h.host_context(), number);
+}
+
+void emit_log(evmc_host_context* ctx, const evmc_address* addr, const uint8_t* data,
+    size_t data_size, const evmc_bytes32 topics[], size_t num_topics) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::emit_log);
+    h.host().emit_log(h.host_context(), addr, data, data_size, topics, num_topics);
+}
+
+evmc_access_status access_account(evmc_host_context* ctx, const evmc_address* addr) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::access_account);
+    return h.host().access_account(h.host_context(), addr);
+}
+
+evmc_access_status access_storage(
+    evmc_host_context* ctx, const evmc_address* addr, const evmc_bytes32* key) noexcept
+{
+    const auto& h = CountingHost::count(ctx, HostCall::access_storage);
+    return h.host().access_storage(h.host_context(), addr, key);
+}
+}  // namespace
+
+const evmc_host_interface CountingHost::interface = {
+    account_exists,
+    get_storage,
+    set_storage,
+    get_balance,
+    get_code_size,
+    get_code_hash,
+    copy_code,
+    selfdestruct,
+    call,
+    get_tx_context,
+    get_block_hash,
+    emit_log,
+    access_account,
+    access_storage,
+};
+}  // namespace evmone
@@ -0,0 +1,94 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <evmc/evmc.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace evmone
+{
+/// The host interface functions.
+enum class HostCall : uint8_t
+{
+    account_exists,
+    get_storage,
+    set_storage,
+    get_balance,
+    get_code_size,
+    get_code_hash,
+    copy_code,
+    selfdestruct,
+    call,
+    get_tx_context,
+    get_block_hash,
+    emit_log,
+    access_account,
+    access_storage,
+};
+
+/// The number of the host interface functions.
+constexpr size_t num_host_calls = static_cast<size_t>(HostCall::access_storage) + 1;
+
+/// The execution counters of a transaction: the top-level execution and all nested ones.
+///
+/// Collected by the Baseline interpreter when enabled by the VM "stats" option
+/// and reset at the start of every top-level (depth 0) execution.
+struct ExecutionStats
+{
+    /// The number of executions, including the nested calls.
+    uint32_t num_executions = 0;
+
+    /// The maximum stack height reached by any execution.
+    uint32_t peak_stack_height = 0;
+
+    /// The number of executed instructions, including the implicit STOP at the code end.
+    uint64_t num_instructions = 0;
+
+    /// The maximum memory size of any execution.
+    uint64_t peak_memory_size = 0;
+
+    /// The time spent in the code analysis in nanoseconds.
+    uint64_t analysis_time = 0;
+
+    /// The number of host calls, indexed by HostCall.
+    uint64_t host_calls[num_host_calls]{};
+
+    [[nodiscard]] uint64_t num_host_calls_of(HostCall kind) const noexcept
+    {
+        return host_calls[static_cast<size_t>(kind)];
+    }
+};
+
+/// The host proxy which forwards the calls to the host and counts them in the stats.
+class CountingHost
+{
+    const evmc_host_interface& m_host;
+    evmc_host_context* const m_context;
+    ExecutionStats& m_stats;
+
+public:
+    /// The interface to use with the context().
+    static const evmc_host_interface interface;
+
+    CountingHost(
+        const evmc_host_interface& host, evmc_host_context* context, ExecutionStats& stats) noexcept
+      : m_host{host}, m_context{context}, m_stats{stats}
+    {}
+
+    /// Returns the host context to use with the CountingHost::interface.
+    evmc_host_context* context() noexcept { return reinterpret_cast<evmc_host_context*>(this); }
+
+    /// Counts the host call and returns the forwarded host interface and context.
+    static const CountingHost& count(evmc_host_context* context, HostCall kind) noexcept
+    {
+        auto& self = *reinterpret_cast<CountingHost*>(context);
+        ++self.m_stats.host_calls[static_cast<size_t>(kind)];
+        return self;
+    }
+
+    [[nodiscard]] const evmc_host_interface& host() const noexcept { return m_host; }
+    [[nodiscard]] evmc_host_context* host_context() const noexcept { return m_context; }
+};
+}  // namespace evmone
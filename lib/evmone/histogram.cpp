@@ -0,0 +1,293 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "histogram.hpp"
+#include "instructions_traits.hpp"
+#include <ethash/keccak.hpp>
+#include <evmc/evmc.hpp>
+#include <evmc/hex.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+namespace evmone
+{
+namespace
+{
+struct Key
+{
+    evmc_revision rev;
+    evmc::bytes32 code_hash;
+
+    friend bool operator==(const Key&, const Key&) noexcept = default;
+
+    friend bool operator<(const Key& a, const Key& b) noexcept
+    {
+        return a.rev < b.rev || (a.rev == b.rev && a.code_hash < b.code_hash);
+    }
+};
+
+struct KeyHash
+{
+    size_t operator()(const Key& key) const noexcept
+    {
+        return std::hash<evmc::bytes32>{}(key.code_hash) ^ static_cast<size_t>(key.rev);
+    }
+};
+
+/// The opcode counters of a single thread. Only the owning thread increments them,
+/// the atomics only make them safe to read and reset by other threads.
+struct Counters
+{
+    std::atomic<uint64_t> counts[256]{};
+};
+
+struct Shard
+{
+    std::mutex mutex;  ///< Guards the map, not the counters.
+    std::unordered_map<Key, std::unique_ptr<Counters>, KeyHash> counters;
+
+    Counters& get(const Key& key)
+    {
+        const std::lock_guard lock{mutex};
+        auto& c = counters[key];
+        if (!c)
+            c = std::make_unique<Counters>();
+        return *c;
+    }
+};
+
+/// The list of all shards. The shards are never destroyed, the ones released by
+/// the exited threads are reused.
+class Registry
+{
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    std::vector<Shard*> m_free_shards;
+
+public:
+    Shard& acquire()
+    {
+        const std::lock_guard lock{m_mutex};
+        if (!m_free_shards.empty())
+        {
+            auto& shard = *m_free_shards.back();
+            m_free_shards.pop_back();
+            return shard;
+        }
+        return *m_shards.emplace_back(std::make_unique<Shard>());
+    }
+
+    void release(Shard& shard)
+    {
+        const std::lock_guard lock{m_mutex};
+        m_free_shards.push_back(&shard);
+    }
+
+    template <typename Fn>
+    void for_each_counters(Fn fn)
+    {
+        const std::lock_guard lock{m_mutex};
+        for (const auto& shard : m_shards)
+        {
+            const std::lock_guard shard_lock{shard->mutex};
+            for (const auto& [key, counters] : shard->counters)
+                fn(key, *counters);
+        }
+    }
+};
+
+Registry& get_registry()
+{
+    static Registry registry;
+    return registry;
+}
+
+/// Returns the shard of the current thread.
+Shard& get_local_shard()
+{
+    struct Owner
+    {
+        Shard& shard = get_registry().acquire();
+        ~Owner() { get_registry().release(shard); }
+    };
+    thread_local Owner owner;
+    return owner.shard;
+}
+
+/// The executions of the current thread being counted, the innermost last.
+///
+/// This is per thread, not per collector, because a VM instance may execute on many threads
+/// at the same time. The nested executions on a thread always end in the reverse order.
+struct LocalExecutions
+{
+    struct Context
+    {
+        const uint8_t* code = nullptr;
+        Counters* counters = nullptr;  ///< Null if the counters could not be created.
+    };
+
+    std::vector<Context> contexts;
+
+    /// The number of the innermost executions without the context because adding it failed.
+    /// The instructions are not counted until these executions end.
+    size_t num_untracked = 0;
+};
+
+thread_local LocalExecutions local_executions;
+
+/// @see create_histogram_collector()
+///
+/// This file is compiled with exceptions: the executions are not counted
+/// if the memory allocation or the locking fails.
+class HistogramCollector : public Tracer
+{
+    void on_execution_start(
+        evmc_revision rev, const evmc_message& /*msg*/, bytes_view code) noexcept override
+    {
+        auto& executions = local_executions;
+        if (executions.num_untracked != 0)
+        {
+            ++executions.num_untracked;
+            return;
+        }
+
+        Key key{rev, {}};
+        const auto h = ethash::keccak256(code.data(), code.size());
+        std::memcpy(key.code_hash.bytes, h.bytes, sizeof(key.code_hash.bytes));
+
+        Counters* counters = nullptr;
+        try
+        {
+            counters = &get_local_shard().get(key);
+        }
+        catch (const std::exception&)  // std::bad_alloc or std::system_error.
+        {}
+
+        try
+        {
+            executions.contexts.push_back({code.data(), counters});
+        }
+        catch (const std::bad_alloc&)
+        {
+            ++executions.num_untracked;
+        }
+    }
+
+    void on_instruction_start(uint32_t pc, const intx::uint256* /*stack_top*/, int /*stack_height*/,
+        int64_t /*gas*/, const ExecutionState& /*state*/) noexcept override
+    {
+        const auto& executions = local_executions;
+        if (executions.num_untracked != 0)
+            return;
+        const auto& ctx = executions.contexts.back();
+        if (ctx.counters == nullptr)
+            return;
+        auto& count = ctx.counters->counts[ctx.code[pc]];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void on_execution_end(const evmc_result& /*result*/) noexcept override
+    {
+        auto& executions = local_executions;
+        if (executions.num_untracked != 0)
+            --executions.num_untracked;
+        else
+            executions.contexts.pop_back();
+    }
+};
+}  // namespace
+
+std::unique_ptr<Tracer> create_histogram_collector()
+{
+    return std::make_unique<HistogramCollector>();
+}
+
+std::vector<evmone_histogram_entry> histogram_snapshot()
+{
+    std::map<Key, evmone_histogram_entry> merged;
+    get_registry().for_each_counters([&merged](const Key& key, const Counters& counters) {
+        auto& entry = merged[key];
+        for (size_t i = 0; i < std::size(counters.counts); ++i)
+            entry.counts[i] += counters.counts[i].load(std::memory_order_relaxed);
+    });
+
+    std::vector<evmone_histogram_entry> entries;
+    entries.reserve(merged.size());
+    for (auto& [key, entry] : merged)
+    {
+        if (std::all_of(std::begin(entry.counts), std::end(entry.counts),
+                [](uint64_t c) noexcept { return c == 0; }))
+            continue;
+        entry.rev = key.rev;
+        entry.code_hash = key.code_hash;
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+void histogram_reset() noexcept
+{
+    get_registry().for_each_counters([](const Key& /*key*/, Counters& counters) noexcept {
+        for (auto& count : counters.counts)
+            count.store(0, std::memory_order_relaxed);
+    });
+}
+
+void write_histogram_json(std::ostream& out, const std::vector<evmone_histogram_entry>& entries)
+{
+    out << '[';
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const auto& entry = entries[i];
+        out << (i == 0 ? "\n" : ",\n") << R"({"rev":")" << entry.rev << R"(","code_hash":"0x)"
+            << evmc::hex({entry.code_hash.bytes, sizeof(entry.code_hash.bytes)})
+            << R"(","counts":{)";
+        bool first = true;
+        for (size_t op = 0; op < std::size(entry.counts); ++op)
+        {
+            if (entry.counts[op] == 0)
+                continue;
+            if (!first)
+                out << ',';
+            first = false;
+            const auto name = instr::traits[op].name;
+            out << '"';
+            if (name != nullptr)
+                out << name;
+            else
+                out << "0x" << evmc::hex(static_cast<uint8_t>(op));
+            out << R"(":)" << entry.counts[op];
+        }
+        out << "}}";
+    }
+    out << "\n]\n";
+}
+}  // namespace evmone
+
+extern "C" {
+EVMC_EXPORT size_t evmone_histogram_snapshot(
+    evmone_histogram_entry* entries, size_t max_entries) noexcept
+{
+    try
+    {
+        const auto snapshot = evmone::histogram_snapshot();
+        std::copy_n(snapshot.begin(), std::min(snapshot.size(), max_entries), entries);
+        return snapshot.size();
+    }
+    catch (const std::exception&)  // std::bad_alloc or std::system_error.
+    {
+        return 0;
+    }
+}
+
+EVMC_EXPORT void evmone_histogram_reset() noexcept
+{
+    evmone::histogram_reset();
+}
+}
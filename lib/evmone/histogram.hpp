@@ -0,0 +1,36 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include "tracing.hpp"
+#include <evmone/evmone.h>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace evmone
+{
+/// Creates the tracer which counts the executed opcodes into the process-wide histogram
+/// aggregated per revision and code hash.
+///
+/// The counters are sharded per thread: the instructions are counted without locking or atomic
+/// read-modify-write operations and the shard mutex (uncontended unless a snapshot is being
+/// taken) is only locked at the execution start to find the counters of the code.
+/// The shards of the exited threads are reused by new threads, so the counts are preserved.
+/// The VM with the collector may execute on many threads at the same time.
+EVMC_EXPORT std::unique_ptr<Tracer> create_histogram_collector();
+
+/// Takes the snapshot of the process-wide histogram. The entries without counts are skipped.
+/// The entries are ordered by revision and code hash.
+EVMC_EXPORT std::vector<evmone_histogram_entry> histogram_snapshot();
+
+/// Resets all counts of the process-wide histogram to zero.
+/// The instructions counted concurrently with the reset may be excluded from it.
+EVMC_EXPORT void histogram_reset() noexcept;
+
+/// Writes the histogram entries as the JSON array of objects
+/// {"rev":"Shanghai","code_hash":"0x...","counts":{"PUSH1":2,...}}.
+EVMC_EXPORT void write_histogram_json(
+    std::ostream& out, const std::vector<evmone_histogram_entry>& entries);
+}  // namespace evmone
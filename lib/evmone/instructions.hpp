@@ -8,6 +8,7 @@
 #include "execution_state.hpp"
 #include "instructions_traits.hpp"
 #include "instructions_xmacro.hpp"
+#include "keccak_cache.hpp"
 #include <ethash/keccak.hpp>
 
 namespace evmone
@@ -356,7 +357,10 @@ inline Result keccak256(StackTop stack, int64_t gas_left, ExecutionState& state)
         return {EVMC_OUT_OF_GAS, gas_left};
 
     auto data = s != 0 ? &state.memory[i] : nullptr;
-    size = intx::be::load<uint256>(ethash::keccak256(data, s));
+    if (state.keccak_cache != nullptr && s <= KeccakCache::max_input_size)
+        size = intx::be::load<uint256>(state.keccak_cache->hash(data, s));
+    else
+        size = intx::be::load<uint256>(ethash::keccak256(data, s));
     return {EVMC_SUCCESS, gas_left};
 }
 
@@ -946,32 +950,23 @@ inline constexpr auto create2 = create_impl<OP_CREATE2>;
 inline code_iterator callf(StackTop stack, ExecutionState& state, code_iterator pos) noexcept
 {
     const auto index = read_uint16_be(&pos[1]);
-    const auto& header = state.analysis.baseline->eof_header;
+    const auto& section = state.analysis.baseline->code_sections[index];
     const auto stack_size = &stack.top() - state.stack_space.bottom();
-    if (stack_size + header.types[index].max_stack_height > StackSpace::limit)
-    {
-        state.status = EVMC_STACK_OVERFLOW;
-        return nullptr;
-    }
-
-    if (state.call_stack.size() >= StackSpace::limit)
+    // TODO: Add different error code for the return stack overflow.
+    if (INTX_UNLIKELY(
+            stack_size + section.max_stack_height > StackSpace::limit || state.call_stack.full()))
     {
-        // TODO: Add different error code.
         state.status = EVMC_STACK_OVERFLOW;
         return nullptr;
     }
-    state.call_stack.push_back(pos + 3);
+    state.call_stack.push(pos + 3);
 
-    const auto offset = header.code_offsets[index] - header.code_offsets[0];
-    auto code = state.analysis.baseline->executable_code;
-    return code.data() + offset;
+    return section.begin;
 }
 
 inline code_iterator retf(StackTop /*stack*/, ExecutionState& state, code_iterator /*pos*/) noexcept
 {
-    const auto p = state.call_stack.back();
-    state.call_stack.pop_back();
-    return p;
+    return static_cast<code_iterator>(state.call_stack.pop());
 }
 
 template <evmc_status_code StatusCode>
@@ -0,0 +1,66 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "keccak_cache.hpp"
+#include <ethash/keccak.hpp>
+#include <cassert>
+#include <cstring>
+
+namespace evmone
+{
+namespace
+{
+/// Computes the cache index of the input by mixing all its 8-byte words.
+/// The input is at most KeccakCache::max_input_size bytes so this is cheap
+/// compared to the Keccak-f permutation.
+inline size_t index_of(const uint8_t* data, size_t size) noexcept
+{
+    uint64_t h = size;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t w;
+        std::memcpy(&w, &data[i], sizeof(w));
+        h = (h ^ w) * 0x9e3779b97f4a7c15;
+    }
+    for (; i < size; ++i)
+        h = (h ^ data[i]) * 0x9e3779b97f4a7c15;
+    return static_cast<size_t>(h >> 56) & (KeccakCache::num_entries - 1);
+}
+}  // namespace
+
+evmc::bytes32 KeccakCache::hash(const uint8_t* data, size_t size) noexcept
+{
+    assert(size <= max_input_size);
+
+    auto& e = m_entries[index_of(data, size)];
+    if (e.generation == m_generation && e.input_size == size &&
+        (size == 0 || std::memcmp(e.input, data, size) == 0))
+    {
+        ++m_hits;
+        return e.hash;
+    }
+
+    ++m_misses;
+    const auto h = ethash::keccak256(data, size);
+    std::memcpy(e.hash.bytes, h.bytes, sizeof(e.hash.bytes));
+    e.generation = m_generation;
+    e.input_size = static_cast<uint32_t>(size);
+    if (size != 0)
+        std::memcpy(e.input, data, size);
+    return e.hash;
+}
+
+void KeccakCache::clear() noexcept
+{
+    if (++m_generation == 0)
+    {
+        // The generation counter wrapped around: the entries from the old generation 1
+        // would become valid again so they must be wiped out.
+        for (size_t i = 0; i < num_entries; ++i)
+            m_entries[i].generation = 0;
+        m_generation = 1;
+    }
+}
+}  // namespace evmone
@@ -0,0 +1,63 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <evmc/evmc.hpp>
+#include <cstdint>
+#include <memory>
+
+namespace evmone
+{
+/// Memoization cache for KECCAK256 of small inputs.
+///
+/// Solidity derives mapping slots as keccak256(key . slot) over 64 bytes of memory, and the same
+/// slot is usually derived several times within a transaction (e.g. read, check, then update).
+/// The cache is direct-mapped and keyed by the complete input bytes. It is invalidated in O(1)
+/// by bumping the generation number, what the VM does at the start of every transaction.
+///
+/// The entries are read and overwritten by executions without locking. A VM with the cache
+/// enabled must not execute in multiple threads at once: use a VM instance per thread instead.
+class KeccakCache
+{
+public:
+    /// The maximum size of the input which is cached.
+    static constexpr size_t max_input_size = 64;
+
+    /// The number of cache entries. Must be a power of 2.
+    static constexpr size_t num_entries = 256;
+
+private:
+    struct Entry
+    {
+        evmc::bytes32 hash;
+        uint32_t generation = 0;  ///< The generation of the entry, 0 means never used.
+        uint32_t input_size = 0;
+        uint8_t input[max_input_size];
+    };
+
+    static_assert((num_entries & (num_entries - 1)) == 0, "num_entries must be power of 2");
+
+    std::unique_ptr<Entry[]> m_entries{new Entry[num_entries]{}};
+    uint32_t m_generation = 1;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+
+public:
+    /// Returns the KECCAK256 hash of the input. The hash is computed only if the input is not
+    /// found in the cache.
+    ///
+    /// @param data  The pointer to the input. May be null if size is 0.
+    /// @param size  The input size, must not exceed max_input_size.
+    [[nodiscard]] evmc::bytes32 hash(const uint8_t* data, size_t size) noexcept;
+
+    /// Invalidates all cache entries. The hit/miss counters are not reset.
+    void clear() noexcept;
+
+    /// The number of hash() calls served from the cache.
+    [[nodiscard]] uint64_t hits() const noexcept { return m_hits; }
+
+    /// The number of hash() calls which computed the hash.
+    [[nodiscard]] uint64_t misses() const noexcept { return m_misses; }
+};
+}  // namespace evmone
@@ -3,18 +3,19 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+/// The PUSH instructions which values fit the Advanced instruction argument.
 #define ANY_SMALL_PUSH \
     OP_PUSH1:          \
     case OP_PUSH2:     \
-    case OP_PUSH3:     \
-    case OP_PUSH4:     \
+    case OP_PUSH3
+
+#define ANY_LARGE_PUSH \
+    OP_PUSH4:          \
     case OP_PUSH5:     \
     case OP_PUSH6:     \
     case OP_PUSH7:     \
-    case OP_PUSH8
-
-#define ANY_LARGE_PUSH \
-    OP_PUSH9:          \
+    case OP_PUSH8:     \
+    case OP_PUSH9:     \
     case OP_PUSH10:    \
     case OP_PUSH11:    \
     case OP_PUSH12:    \
@@ -0,0 +1,19 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sampler.hpp"
+#include <algorithm>
+
+namespace evmone
+{
+std::vector<Sample> Sampler::samples() const
+{
+    const auto n = static_cast<size_t>(std::min<uint64_t>(m_num_samples, capacity));
+    std::vector<Sample> result;
+    result.reserve(n);
+    for (auto i = m_num_samples - n; i != m_num_samples; ++i)
+        result.push_back(m_samples[i & (capacity - 1)]);
+    return result;
+}
+}  // namespace evmone
@@ -0,0 +1,81 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <evmc/evmc.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace evmone
+{
+/// The instruction sample.
+struct Sample
+{
+    evmc::bytes32 code_hash;  ///< The KECCAK256 hash of the executed code.
+    uint32_t pc = 0;          ///< The offset of the instruction in the code (or EOF container).
+    uint8_t opcode = 0;
+    int32_t depth = 0;  ///< The call depth.
+};
+
+/// Sampling instruction profiler.
+///
+/// Unlike tracers, which force the interpreter into the instrumented loop, the sampler keeps
+/// the regular loop with a single countdown decrement per instruction. Every period-th instruction
+/// (counted across all executions, including nested calls) is recorded into a fixed-size ring
+/// buffer, where the newest samples replace the oldest ones. The code hash is computed only
+/// for the executions which got sampled, at most once per execution.
+///
+/// The countdown is shared by all executions of the VM, so the samples of concurrent executions
+/// would race on it and on the ring buffer. Read the samples between executions.
+class Sampler
+{
+public:
+    /// The number of samples kept. Must be a power of 2.
+    static constexpr size_t capacity = 4096;
+
+    /// The default sampling period in instructions.
+    static constexpr uint32_t default_period = 10007;
+
+private:
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be power of 2");
+
+    std::unique_ptr<Sample[]> m_samples{new Sample[capacity]};
+    uint64_t m_num_samples = 0;  ///< The number of all recorded samples, including replaced.
+    uint32_t m_period;
+    uint32_t m_countdown;
+
+public:
+    /// @param period  The sampling period in instructions, must not be 0.
+    explicit Sampler(uint32_t period = default_period) noexcept
+      : m_period{period}, m_countdown{period}
+    {}
+
+    [[nodiscard]] uint32_t period() const noexcept { return m_period; }
+
+    /// Counts the executed instruction. Returns true when the instruction should be sampled.
+    [[nodiscard]] bool tick() noexcept
+    {
+        if (--m_countdown != 0)
+            return false;
+        m_countdown = m_period;
+        return true;
+    }
+
+    /// Records the sample.
+    void record(const Sample& sample) noexcept
+    {
+        m_samples[m_num_samples++ & (capacity - 1)] = sample;
+    }
+
+    /// The number of all recorded samples, including the ones already replaced.
+    [[nodiscard]] uint64_t num_samples() const noexcept { return m_num_samples; }
+
+    /// Returns the kept samples, the oldest first.
+    [[nodiscard]] std::vector<Sample> samples() const;
+
+    /// Removes all samples. The countdown is not restarted.
+    void clear() noexcept { m_num_samples = 0; }
+};
+}  // namespace evmone
@@ -3,10 +3,27 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "tracing.hpp"
+#include "binary_trace.hpp"
 #include "execution_state.hpp"
 #include "instructions_traits.hpp"
 #include <evmc/hex.hpp>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
 #include <stack>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__)
+#include <x86intrin.h>
+#endif
 
 namespace evmone
 {
@@ -157,6 +174,427 @@ public:
         m_out << std::dec;  // Set number formatting to dec, JSON does not support other forms.
     }
 };
+
+/// Reads the cycle counter.
+inline uint64_t read_cycles() noexcept
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+#endif
+}
+
+/// @see create_cycle_tracer()
+class CycleTracerImpl : public CycleTracer
+{
+    /// The number of the histogram buckets of the exact small values.
+    static constexpr size_t num_exact_buckets = 16;
+
+    /// The number of the histogram buckets per power of 2 for values above the exact ones.
+    static constexpr size_t num_sub_buckets = 4;
+
+    static constexpr size_t num_buckets = num_exact_buckets + (64 - 4) * num_sub_buckets;
+
+    struct OpcodeStats
+    {
+        uint64_t count = 0;
+        uint64_t total = 0;
+        uint32_t buckets[num_buckets]{};
+    };
+
+    struct Context
+    {
+        const evmc_revision rev;
+        const uint8_t* const code;
+        int last_opcode = -1;  ///< The opcode of the measured instruction, -1 if none.
+        uint64_t start = 0;    ///< The cycle counter at the instruction start or resume.
+        uint64_t cycles = 0;   ///< The cycles of the instruction before a nested call.
+
+        Context(evmc_revision r, const uint8_t* c) noexcept : rev{r}, code{c} {}
+    };
+
+    /// The statistics per revision, allocated on the first use.
+    std::unique_ptr<OpcodeStats[]> m_stats[EVMC_MAX_REVISION + 1];
+
+    std::stack<Context> m_contexts;
+
+    static size_t bucket_index(uint64_t cycles) noexcept
+    {
+        if (cycles < num_exact_buckets)
+            return static_cast<size_t>(cycles);
+        const auto e = static_cast<size_t>(std::bit_width(cycles)) - 1;  // e >= 4
+        const auto sub = static_cast<size_t>(cycles >> (e - 2)) & (num_sub_buckets - 1);
+        return num_exact_buckets + (e - 4) * num_sub_buckets + sub;
+    }
+
+    /// Returns the lower bound of the values of the bucket.
+    static uint64_t bucket_value(size_t index) noexcept
+    {
+        if (index < num_exact_buckets)
+            return index;
+        const auto e = (index - num_exact_buckets) / num_sub_buckets + 4;
+        const auto sub = (index - num_exact_buckets) % num_sub_buckets;
+        return uint64_t{num_sub_buckets + sub} << (e - 2);
+    }
+
+    /// Attributes the cycles to the last instruction of the context, if any.
+    void record(Context& ctx, uint64_t now) noexcept
+    {
+        if (ctx.last_opcode < 0)
+            return;
+
+        const auto cycles = ctx.cycles + (now - ctx.start);
+        auto& rev_stats = m_stats[ctx.rev];
+        if (!rev_stats)
+            rev_stats.reset(new OpcodeStats[256]);
+        auto& stats = rev_stats[static_cast<size_t>(ctx.last_opcode)];
+        ++stats.count;
+        stats.total += cycles;
+        ++stats.buckets[bucket_index(cycles)];
+    }
+
+    void on_execution_start(
+        evmc_revision rev, const evmc_message& /*msg*/, bytes_view code) noexcept override
+    {
+        if (!m_contexts.empty())
+        {
+            // Pause the measurement of the call instruction of the parent.
+            auto& parent = m_contexts.top();
+            parent.cycles += read_cycles() - parent.start;
+        }
+        m_contexts.emplace(rev, code.data());
+    }
+
+    void on_instruction_start(uint32_t pc, const intx::uint256* /*stack_top*/,
+        int /*stack_height*/, int64_t /*gas*/, const ExecutionState& /*state*/) noexcept override
+    {
+        const auto now = read_cycles();
+        auto& ctx = m_contexts.top();
+        record(ctx, now);
+        ctx.last_opcode = ctx.code[pc];
+        ctx.cycles = 0;
+        ctx.start = read_cycles();  // Exclude the tracer's own cost.
+    }
+
+    void on_execution_end(const evmc_result& /*result*/) noexcept override
+    {
+        record(m_contexts.top(), read_cycles());
+        m_contexts.pop();
+
+        if (!m_contexts.empty())
+            m_contexts.top().start = read_cycles();  // Resume the parent's call instruction.
+    }
+
+public:
+    void report(std::ostream& out) const override
+    {
+        out << "rev,opcode,count,total,mean,p99\n";
+        for (size_t r = 0; r < std::size(m_stats); ++r)
+        {
+            if (!m_stats[r])
+                continue;
+
+            for (size_t op = 0; op < 256; ++op)
+            {
+                const auto& stats = m_stats[r][op];
+                if (stats.count == 0)
+                    continue;
+
+                // The p99 is the lower bound of the bucket where the 99% of samples is reached.
+                const auto p99_rank = (stats.count * 99 + 99) / 100;
+                uint64_t seen = 0;
+                size_t p99_bucket = 0;
+                while ((seen += stats.buckets[p99_bucket]) < p99_rank)
+                    ++p99_bucket;
+
+                out << static_cast<evmc_revision>(r) << ',' << get_name(static_cast<uint8_t>(op))
+                    << ',' << stats.count << ',' << stats.total << ','
+                    << stats.total / stats.count << ',' << bucket_value(p99_bucket) << '\n';
+            }
+        }
+    }
+
+    void reset() noexcept override
+    {
+        for (auto& rev_stats : m_stats)
+            rev_stats.reset();
+    }
+};
+
+/// @see create_profile_tracer()
+class ProfileTracer : public Tracer
+{
+    using clock = std::chrono::steady_clock;
+
+    struct Frame
+    {
+        std::string name;
+        int64_t gas_limit = 0;
+        clock::time_point start_time;
+        int64_t children_gas_used = 0;
+        int64_t children_time = 0;  ///< Nanoseconds.
+    };
+
+    struct Cost
+    {
+        int64_t gas_used = 0;
+        int64_t time = 0;  ///< Nanoseconds.
+    };
+
+    std::FILE* const m_gas_file;
+    std::FILE* const m_time_file;
+
+    /// The frames of the current call stack, the outermost first.
+    std::vector<Frame> m_frames;
+
+    /// The self costs of the frames of the current transaction, by the folded stack.
+    std::map<std::string, Cost> m_costs;
+
+    static const char* get_kind_name(evmc_call_kind kind) noexcept
+    {
+        switch (kind)
+        {
+        case EVMC_CALL:
+            return "CALL";
+        case EVMC_DELEGATECALL:
+            return "DELEGATECALL";
+        case EVMC_CALLCODE:
+            return "CALLCODE";
+        case EVMC_CREATE:
+            return "CREATE";
+        case EVMC_CREATE2:
+            return "CREATE2";
+        default:
+            return "UNKNOWN";
+        }
+    }
+
+    void on_execution_start(
+        evmc_revision /*rev*/, const evmc_message& msg, bytes_view /*code*/) noexcept override
+    {
+        // The created contract has no code address, its new address is the recipient.
+        const auto is_create = msg.kind == EVMC_CREATE || msg.kind == EVMC_CREATE2;
+        const auto& address = is_create ? msg.recipient : msg.code_address;
+
+        auto& frame = m_frames.emplace_back();
+        frame.name = get_kind_name(msg.kind);
+        frame.name += ":0x";
+        frame.name += evmc::hex({address.bytes, sizeof(address.bytes)});
+        frame.gas_limit = msg.gas;
+        frame.start_time = clock::now();
+    }
+
+    [[nodiscard]] bool traces_instructions() const noexcept override { return false; }
+
+    void on_instruction_start(uint32_t /*pc*/, const intx::uint256* /*stack_top*/,
+        int /*stack_height*/, int64_t /*gas*/, const ExecutionState& /*state*/) noexcept override
+    {}
+
+    void on_execution_end(const evmc_result& result) noexcept override
+    {
+        const auto& frame = m_frames.back();
+        const auto gas_used = frame.gas_limit - result.gas_left;
+        const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock::now() - frame.start_time)
+                              .count();
+
+        std::string stack;
+        for (const auto& f : m_frames)
+        {
+            if (!stack.empty())
+                stack += ';';
+            stack += f.name;
+        }
+        auto& cost = m_costs[stack];
+        cost.gas_used += gas_used - frame.children_gas_used;
+        cost.time += time - frame.children_time;
+
+        m_frames.pop_back();
+        if (!m_frames.empty())
+        {
+            m_frames.back().children_gas_used += gas_used;
+            m_frames.back().children_time += time;
+        }
+        else
+            flush();
+    }
+
+    /// Appends the folded stacks of the finished transaction to the files.
+    void flush() noexcept
+    {
+        for (const auto& [stack, cost] : m_costs)
+        {
+            std::fprintf(m_gas_file, "%s %lld\n", stack.c_str(),
+                static_cast<long long>(std::max(cost.gas_used, int64_t{0})));
+            std::fprintf(m_time_file, "%s %lld\n", stack.c_str(),
+                static_cast<long long>(std::max(cost.time, int64_t{0})));
+        }
+        std::fflush(m_gas_file);
+        std::fflush(m_time_file);
+        m_costs.clear();
+    }
+
+public:
+    ProfileTracer(std::FILE* gas_file, std::FILE* time_file) noexcept
+      : m_gas_file{gas_file}, m_time_file{time_file}
+    {}
+
+    ~ProfileTracer() override
+    {
+        std::fclose(m_gas_file);
+        std::fclose(m_time_file);
+    }
+};
+
+/// @see create_binary_tracer()
+class BinaryTracer : public Tracer
+{
+    using Record = binary_trace::Record;
+    using RecordKind = binary_trace::RecordKind;
+
+    /// The number of records in the ring buffer. Must be power of 2.
+    static constexpr size_t ring_size = size_t{1} << 16;
+    static_assert((ring_size & (ring_size - 1)) == 0, "ring_size must be power of 2");
+
+    std::unique_ptr<Record[]> m_ring{new Record[ring_size]};
+
+    /// The number of records written by the execution thread.
+    alignas(64) std::atomic<size_t> m_head = 0;
+
+    /// The number of records written to the file by the writer thread.
+    alignas(64) std::atomic<size_t> m_tail = 0;
+
+    std::atomic<bool> m_stop = false;
+    std::FILE* const m_file;
+    std::thread m_writer;
+
+    /// The code of the nested executions.
+    std::stack<const uint8_t*> m_codes;
+
+    /// Returns the next free record. Waits for the writer thread if the ring buffer is full.
+    Record& next_record() noexcept
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        while (head - m_tail.load(std::memory_order_acquire) == ring_size)
+            std::this_thread::yield();
+        auto& r = m_ring[head & (ring_size - 1)];
+        r = {};
+        return r;
+    }
+
+    /// Publishes the record returned by next_record() to the writer thread.
+    void commit_record() noexcept
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// The writer thread loop: drains the ring buffer to the file until stopped.
+    void write_records() noexcept
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            // The stop flag is loaded before the head so the final records are not missed.
+            const auto stop = m_stop.load(std::memory_order_acquire);
+            const auto head = m_head.load(std::memory_order_acquire);
+            if (head == tail)
+            {
+                if (stop)
+                    break;
+                std::this_thread::sleep_for(std::chrono::microseconds{100});
+                continue;
+            }
+
+            // Write the continuous part of the ring buffer.
+            const auto begin = tail & (ring_size - 1);
+            const auto count = std::min(head - tail, ring_size - begin);
+            std::fwrite(&m_ring[begin], sizeof(Record), count, m_file);
+            tail += count;
+            m_tail.store(tail, std::memory_order_release);
+        }
+        std::fflush(m_file);
+    }
+
+    void on_execution_start(
+        evmc_revision rev, const evmc_message& msg, bytes_view code) noexcept override
+    {
+        m_codes.push(code.data());
+
+        auto& r = next_record();
+        r.kind = RecordKind::execution_start;
+        r.is_static = (msg.flags & EVMC_STATIC) != 0;
+        r.value = msg.depth;
+        r.pc = static_cast<uint32_t>(rev);
+        r.gas = msg.gas;
+        commit_record();
+    }
+
+    void on_instruction_start(uint32_t pc, const intx::uint256* stack_top, int stack_height,
+        int64_t gas, const ExecutionState& state) noexcept override
+    {
+        const auto num_stack_items =
+            std::min(static_cast<size_t>(stack_height), binary_trace::max_stack_items);
+
+        auto& r = next_record();
+        r.kind = RecordKind::instruction;
+        r.opcode = m_codes.top()[pc];
+        r.data_size = static_cast<uint8_t>(num_stack_items);
+        r.value = stack_height;
+        r.pc = pc;
+        r.gas = gas;
+        r.size = state.memory.size();
+        for (size_t i = 0; i < num_stack_items; ++i)
+            std::memcpy(r.data[i], &stack_top[-static_cast<ptrdiff_t>(i)], sizeof(r.data[i]));
+        commit_record();
+    }
+
+    void on_execution_end(const evmc_result& result) noexcept override
+    {
+        m_codes.pop();
+
+        auto& r = next_record();
+        r.kind = RecordKind::execution_end;
+        r.value = result.status_code;
+        r.gas = result.gas_left;
+        r.size = result.output_size;
+        commit_record();
+
+        for (size_t offset = 0; offset < result.output_size;
+             offset += binary_trace::max_output_chunk_size)
+        {
+            const auto chunk_size =
+                std::min(result.output_size - offset, binary_trace::max_output_chunk_size);
+            auto& o = next_record();
+            o.kind = RecordKind::output;
+            o.data_size = static_cast<uint8_t>(chunk_size);
+            std::memcpy(o.data, &result.output_data[offset], chunk_size);
+            commit_record();
+        }
+    }
+
+public:
+    explicit BinaryTracer(std::FILE* file) noexcept : m_file{file}
+    {
+        binary_trace::FileHeader header{};
+        std::copy(std::begin(header.expected_magic), std::end(header.expected_magic),
+            std::begin(header.magic));
+        header.version = binary_trace::FileHeader::expected_version;
+        header.record_size = sizeof(Record);
+        std::fwrite(&header, sizeof(header), 1, m_file);
+
+        m_writer = std::thread{[this]() noexcept { write_records(); }};
+    }
+
+    ~BinaryTracer() override
+    {
+        m_stop.store(true, std::memory_order_release);
+        m_writer.join();
+        std::fclose(m_file);
+    }
+};
 }  // namespace
 
 std::unique_ptr<Tracer> create_histogram_tracer(std::ostream& out)
@@ -168,4 +606,33 @@ std::unique_ptr<Tracer> create_instruction_tracer(std::ostream& out)
 {
     return std::make_unique<InstructionTracer>(out);
 }
+
+std::unique_ptr<CycleTracer> create_cycle_tracer()
+{
+    return std::make_unique<CycleTracerImpl>();
+}
+
+std::unique_ptr<Tracer> create_profile_tracer(const char* path)
+{
+    const auto gas_path = std::string{path} + ".gas.folded";
+    const auto time_path = std::string{path} + ".time.folded";
+    auto* const gas_file = std::fopen(gas_path.c_str(), "w");
+    if (gas_file == nullptr)
+        return nullptr;
+    auto* const time_file = std::fopen(time_path.c_str(), "w");
+    if (time_file == nullptr)
+    {
+        std::fclose(gas_file);
+        return nullptr;
+    }
+    return std::make_unique<ProfileTracer>(gas_file, time_file);
+}
+
+std::unique_ptr<Tracer> create_binary_tracer(const char* path)
+{
+    auto* const file = std::fopen(path, "wb");
+    if (file == nullptr)
+        return nullptr;
+    return std::make_unique<BinaryTracer>(file);
+}
 }  // namespace evmone
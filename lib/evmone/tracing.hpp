@@ -48,7 +48,18 @@ public:
             m_next_tracer->notify_instruction_start(pc, stack_top, stack_height, gas, state);
     }
 
+    /// Checks if any tracer in the list needs the instruction start notifications.
+    /// If none does, the execution is not instrumented per instruction.
+    [[nodiscard]] bool wants_instructions() const noexcept  // NOLINT(misc-no-recursion)
+    {
+        return traces_instructions() || (m_next_tracer && m_next_tracer->wants_instructions());
+    }
+
 private:
+    /// Returns false if the tracer only needs the execution start and end notifications.
+    /// It is still notified about the instructions if another tracer in the list needs them.
+    [[nodiscard]] virtual bool traces_instructions() const noexcept { return true; }
+
     virtual void on_execution_start(
         evmc_revision rev, const evmc_message& msg, bytes_view code) noexcept = 0;
     virtual void on_instruction_start(uint32_t pc, const intx::uint256* stack_top, int stack_height,
@@ -65,4 +76,50 @@ EVMC_EXPORT std::unique_ptr<Tracer> create_histogram_tracer(std::ostream& out);
 
 EVMC_EXPORT std::unique_ptr<Tracer> create_instruction_tracer(std::ostream& out);
 
+/// The tracer measuring the CPU cycles spent in individual instructions.
+///
+/// The cycles elapsed between the starts of consecutive instructions are attributed to the
+/// former instruction. The cycles spent in nested calls are excluded from the call instruction.
+/// The statistics are aggregated per revision and opcode across all executions until reset.
+class CycleTracer : public Tracer
+{
+public:
+    /// Writes the statistics in CSV format: rev,opcode,count,total,mean,p99.
+    /// The p99 is approximated with the precision of 1/4 of the power of 2.
+    virtual void report(std::ostream& out) const = 0;
+
+    /// Clears the collected statistics.
+    virtual void reset() noexcept = 0;
+};
+
+/// Creates the cycle tracer. The cycles are measured with the TSC on x86-64
+/// and with the steady clock in nanoseconds on other architectures.
+EVMC_EXPORT std::unique_ptr<CycleTracer> create_cycle_tracer();
+
+/// Creates the call-tree profiler which measures the gas used and the wall time of every call
+/// frame and writes them in the folded stack format consumable by flame graph tools.
+///
+/// Every frame is named by the call kind and the code address, e.g. "CALL:0x00..01",
+/// and the frames are joined with ';' from the outermost one. The values are the frame's own
+/// gas and time, excluding the nested calls. The stacks of every transaction (top-level
+/// execution) are appended to the files when the transaction ends.
+///
+/// @param path  The output files path prefix. The gas profile is written to path.gas.folded
+///              and the wall time profile in nanoseconds to path.time.folded.
+/// @return      Profile tracer object or null if the files cannot be opened.
+EVMC_EXPORT std::unique_ptr<Tracer> create_profile_tracer(const char* path);
+
+/// Creates the binary tracer which records every instruction execution in the binary format
+/// defined in binary_trace.hpp.
+///
+/// The records are collected in a ring buffer and written to the file by a background thread,
+/// what makes the tracing cost much lower than of the JSON instruction tracer. The file is
+/// complete once the tracer is destroyed. Only the top binary_trace::max_stack_items stack items
+/// are recorded. Use the evmone-tracedecode tool to convert the trace to the JSON format of the
+/// instruction tracer.
+///
+/// @param path  The trace file path.
+/// @return      Binary tracer object or null if the file cannot be opened.
+EVMC_EXPORT std::unique_ptr<Tracer> create_binary_tracer(const char* path);
+
 }  // namespace evmone
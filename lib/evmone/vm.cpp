@@ -8,9 +8,14 @@
 #include "vm.hpp"
 #include "advanced_execution.hpp"
 #include "baseline.hpp"
+#include "histogram.hpp"
 #include <evmone/evmone.h>
 #include <cassert>
+#include <charconv>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <string>
 
 #ifdef GLOBE_BUILD
 #define PROJECT_VERSION "0.10.0"
@@ -31,6 +36,17 @@ constexpr evmc_capabilities_flagset get_capabilities(evmc_vm* /*vm*/) noexcept
     return EVMC_CAPABILITY_EVM1;
 }
 
+/// Parses the value of the on/off option: empty or "yes" enables, "no" disables.
+/// Returns empty optional for any other value.
+std::optional<bool> parse_yes_no(std::string_view value) noexcept
+{
+    if (value.empty() || value == "yes")
+        return true;
+    if (value == "no")
+        return false;
+    return {};
+}
+
 evmc_set_option_result set_option(evmc_vm* c_vm, char const* c_name, char const* c_value) noexcept
 {
     const auto name = (c_name != nullptr) ? std::string_view{c_name} : std::string_view{};
@@ -60,11 +76,122 @@ evmc_set_option_result set_option(evmc_vm* c_vm, char const* c_name, char const*
         vm.add_tracer(create_instruction_tracer(std::cerr));
         return EVMC_SET_OPTION_SUCCESS;
     }
+    else if (name == "binary_trace")
+    {
+        if (value.empty())
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        auto tracer = create_binary_tracer(std::string{value}.c_str());
+        if (tracer == nullptr)
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        vm.add_tracer(std::move(tracer));
+        return EVMC_SET_OPTION_SUCCESS;
+    }
+    else if (name == "profile")
+    {
+        if (value.empty())
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        auto tracer = create_profile_tracer(std::string{value}.c_str());
+        if (tracer == nullptr)
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        vm.add_tracer(std::move(tracer));
+        return EVMC_SET_OPTION_SUCCESS;
+    }
+    else if (name == "cycles")
+    {
+        vm.enable_cycle_tracer();
+        return EVMC_SET_OPTION_SUCCESS;
+    }
+    else if (name == "cycles_report")
+    {
+        auto* const tracer = vm.get_cycle_tracer();
+        if (tracer == nullptr)
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        tracer->report(std::cerr);
+        if (value == "reset")
+            tracer->reset();
+        return EVMC_SET_OPTION_SUCCESS;
+    }
     else if (name == "histogram")
     {
         vm.add_tracer(create_histogram_tracer(std::cerr));
         return EVMC_SET_OPTION_SUCCESS;
     }
+    else if (name == "histogram_collect")
+    {
+        vm.add_tracer(create_histogram_collector());
+        return EVMC_SET_OPTION_SUCCESS;
+    }
+    else if (name == "histogram_json")
+    {
+        if (value.empty())
+        {
+            write_histogram_json(std::cerr, histogram_snapshot());
+            return EVMC_SET_OPTION_SUCCESS;
+        }
+        std::ofstream out{std::string{value}};
+        if (!out)
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        write_histogram_json(out, histogram_snapshot());
+        return EVMC_SET_OPTION_SUCCESS;
+    }
+    else if (name == "keccak_cache")
+    {
+        const auto enabled = parse_yes_no(value);
+        if (!enabled.has_value())
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        if (!vm.enable_keccak_cache(*enabled))
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        return EVMC_SET_OPTION_SUCCESS;
+    }
+    else if (name == "coverage")
+    {
+        // The coverage is collected only for the legacy code executed by the Baseline
+        // interpreter. The EOF code, the executions traced per instruction (e.g. with
+        // the "trace" option) and the Advanced interpreter are skipped silently.
+        const auto enabled = parse_yes_no(value);
+        if (!enabled.has_value())
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        if (!vm.enable_coverage(*enabled))
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        return EVMC_SET_OPTION_SUCCESS;
+    }
+    else if (name == "coverage_report")
+    {
+        auto* const coverage = vm.get_coverage();
+        if (coverage == nullptr)
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        coverage->report(std::cerr);
+        if (value == "reset")
+            coverage->clear();
+        return EVMC_SET_OPTION_SUCCESS;
+    }
+    else if (name == "stats")
+    {
+        const auto enabled = parse_yes_no(value);
+        if (!enabled.has_value())
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        vm.enable_stats(*enabled);
+        return EVMC_SET_OPTION_SUCCESS;
+    }
+    else if (name == "sampling")
+    {
+        if (value.empty())
+        {
+            vm.enable_sampler(Sampler::default_period);
+            return EVMC_SET_OPTION_SUCCESS;
+        }
+        if (value == "no")
+        {
+            vm.enable_sampler(0);
+            return EVMC_SET_OPTION_SUCCESS;
+        }
+        uint32_t period = 0;
+        const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), period);
+        if (ec != std::errc{} || end != value.data() + value.size() || period == 0)
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        vm.enable_sampler(period);
+        return EVMC_SET_OPTION_SUCCESS;
+    }
     return EVMC_SET_OPTION_INVALID_NAME;
 }
 
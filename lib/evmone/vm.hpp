@@ -3,8 +3,13 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+#include "coverage.hpp"
+#include "execution_stats.hpp"
+#include "keccak_cache.hpp"
+#include "sampler.hpp"
 #include "tracing.hpp"
 #include <evmc/evmc.h>
+#include <new>
 
 #if defined(_MSC_VER) && !defined(__clang__)
 #define EVMONE_CGOTO_SUPPORTED 0
@@ -22,6 +27,11 @@ public:
 
 private:
     std::unique_ptr<Tracer> m_first_tracer;
+    std::unique_ptr<KeccakCache> m_keccak_cache;
+    std::unique_ptr<Sampler> m_sampler;
+    std::unique_ptr<Coverage> m_coverage;
+    std::unique_ptr<ExecutionStats> m_stats;
+    CycleTracer* m_cycle_tracer = nullptr;  ///< The cycle tracer in the tracers list, if added.
 
 public:
     inline constexpr VM() noexcept;
@@ -36,5 +46,76 @@ public:
     }
 
     [[nodiscard]] Tracer* get_tracer() const noexcept { return m_first_tracer.get(); }
+
+    /// Adds the cycle tracer to the tracers list unless already added.
+    CycleTracer& enable_cycle_tracer() noexcept
+    {
+        if (m_cycle_tracer == nullptr)
+        {
+            auto tracer = create_cycle_tracer();
+            m_cycle_tracer = tracer.get();
+            add_tracer(std::move(tracer));
+        }
+        return *m_cycle_tracer;
+    }
+
+    /// Returns the cycle tracer or null if it has not been added.
+    [[nodiscard]] CycleTracer* get_cycle_tracer() const noexcept { return m_cycle_tracer; }
+
+    /// Enables or disables the KECCAK256 cache. Enabling keeps the existing cache.
+    /// Returns false if the memory for the cache cannot be allocated.
+    [[nodiscard]] bool enable_keccak_cache(bool enable) noexcept
+    {
+        if (!enable)
+            m_keccak_cache.reset();
+        else if (!m_keccak_cache)
+            m_keccak_cache.reset(new (std::nothrow) KeccakCache{});
+        return m_keccak_cache != nullptr || !enable;
+    }
+
+    /// Returns the KECCAK256 cache or null if it is disabled.
+    [[nodiscard]] KeccakCache* get_keccak_cache() const noexcept { return m_keccak_cache.get(); }
+
+    /// Enables the sampling profiler with the given period (replacing the existing one)
+    /// or disables it if the period is 0.
+    void enable_sampler(uint32_t period) noexcept
+    {
+        m_sampler = (period != 0) ? std::make_unique<Sampler>(period) : nullptr;
+    }
+
+    /// Returns the sampling profiler or null if it is disabled.
+    /// The sampling is done by the Baseline interpreter unless a tracer of the instructions
+    /// is added.
+    [[nodiscard]] Sampler* get_sampler() const noexcept { return m_sampler.get(); }
+
+    /// Enables or disables the basic block coverage collector. Enabling keeps the existing one.
+    /// Returns false if the memory for the collector cannot be allocated.
+    [[nodiscard]] bool enable_coverage(bool enable) noexcept
+    {
+        if (!enable)
+            m_coverage.reset();
+        else if (!m_coverage)
+            m_coverage.reset(new (std::nothrow) Coverage{});
+        return m_coverage != nullptr || !enable;
+    }
+
+    /// Returns the basic block coverage collector or null if it is disabled.
+    /// The coverage is collected by the Baseline interpreter for the legacy code
+    /// unless a tracer of the instructions is added. Other executions are not covered.
+    [[nodiscard]] Coverage* get_coverage() const noexcept { return m_coverage.get(); }
+
+    /// Enables or disables the execution stats collection. Enabling keeps the existing stats.
+    void enable_stats(bool enable) noexcept
+    {
+        if (!enable)
+            m_stats.reset();
+        else if (!m_stats)
+            m_stats = std::make_unique<ExecutionStats>();
+    }
+
+    /// Returns the stats of the last transaction or null if the collection is disabled.
+    /// The stats are collected by the Baseline interpreter. The instructions and the stack
+    /// height are not counted while a tracer of the instructions is added.
+    [[nodiscard]] ExecutionStats* get_stats() const noexcept { return m_stats.get(); }
 };
 }  // namespace evmone
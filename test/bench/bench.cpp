@@ -3,16 +3,21 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "../statetest/statetest.hpp"
+#include "block_benchmarks.hpp"
 #include "helpers.hpp"
 #include "synthetic_benchmarks.hpp"
+#include "synthetic_code.hpp"
 #include <benchmark/benchmark.h>
 #include <evmc/evmc.hpp>
 #include <evmc/loader.h>
 #include <evmone/evmone.h>
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <span>
+#include <thread>
 
 namespace fs = std::filesystem;
 
@@ -24,6 +29,10 @@ std::map<std::string_view, evmc::VM> registered_vms;
 
 namespace
 {
+/// Enables the multi-threaded throughput scaling benchmarks.
+/// Set by the --multithreaded command line option.
+bool multithreaded_enabled = false;
+
 struct BenchmarkCase
 {
     struct Input
@@ -119,7 +128,7 @@ void register_benchmarks(std::span<const BenchmarkCase> benchmark_cases)
         {
             RegisterBenchmark(("advanced/analyse/" + b.name).c_str(), [&b](State& state) {
                 bench_analyse<advanced::AdvancedCodeAnalysis, advanced_analyse>(
-                    state, default_revision, b.code);
+                    state, get_revision(b.code), b.code);
             })->Unit(kMicrosecond);
         }
 
@@ -127,7 +136,14 @@ void register_benchmarks(std::span<const BenchmarkCase> benchmark_cases)
         {
             RegisterBenchmark(("baseline/analyse/" + b.name).c_str(), [&b](State& state) {
                 bench_analyse<baseline::CodeAnalysis, baseline_analyse>(
-                    state, default_revision, b.code);
+                    state, get_revision(b.code), b.code);
+            })->Unit(kMicrosecond);
+        }
+
+        if (is_eof_container(b.code))
+        {
+            RegisterBenchmark(("eof/validate/" + b.name).c_str(), [&b](State& state) {
+                bench_validate_eof(state, EVMC_CANCUN, b.code);
             })->Unit(kMicrosecond);
         }
 
@@ -159,6 +175,26 @@ void register_benchmarks(std::span<const BenchmarkCase> benchmark_cases)
                 })->Unit(kMicrosecond);
             }
 
+            if (baseline_vm != nullptr && multithreaded_enabled)
+            {
+                // Run on 1, 2, 4, ... threads up to the number of cores
+                // with the shared VM instance or with a VM instance per thread.
+                const auto max_threads = static_cast<int>(
+                    std::max(std::thread::hardware_concurrency(), 1u));
+                for (auto* const shared_vm : {baseline_vm, static_cast<evmc::VM*>(nullptr)})
+                {
+                    const auto* const prefix =
+                        (shared_vm != nullptr) ? "baseline/mt_shared/" : "baseline/mt_own/";
+                    const auto name = prefix + case_name;
+                    RegisterBenchmark(name.c_str(), [shared_vm, &b, &input](State& state) {
+                        bench_baseline_execute_mt(state, shared_vm, b.code, input.input);
+                    })
+                        ->ThreadRange(1, max_threads)
+                        ->UseRealTime()
+                        ->Unit(kMicrosecond);
+                }
+            }
+
             for (auto& [vm_name, vm] : registered_vms)
             {
                 const auto name = std::string{vm_name} + "/total/" + case_name;
@@ -170,6 +206,31 @@ void register_benchmarks(std::span<const BenchmarkCase> benchmark_cases)
     }
 }
 
+/// Registers the multi-threaded benchmarks executing through the state transition Host.
+///
+/// The code calls the identity precompile in the loop, so the threads share
+/// the process-wide precompile results cache. The other precompiles are not implemented
+/// in the state transition Host and would only insert their failures into the cache.
+void register_state_mt_benchmarks()
+{
+    static const auto identity_code = generate_loop_v2(
+        16 * (push(32) + push(0) + push(32) + push(0) + push(0x04) + OP_GAS + OP_STATICCALL +
+                 OP_POP));
+
+    const auto max_threads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+    for (auto* const shared_vm : {&registered_vms.at("baseline"), static_cast<evmc::VM*>(nullptr)})
+    {
+        const auto* const prefix = (shared_vm != nullptr) ? "state/mt_shared/" : "state/mt_own/";
+        const auto name = std::string{prefix} + "precompile/identity";
+        RegisterBenchmark(name.c_str(), [shared_vm](State& state) {
+            bench_state_execute_mt(state, shared_vm, identity_code);
+        })
+            ->ThreadRange(1, max_threads)
+            ->UseRealTime()
+            ->Unit(kMicrosecond);
+    }
+}
+
 
 /// The error code for CLI arguments parsing error in evmone-bench.
 /// The number tries to be different from EVMC loading error codes.
@@ -177,6 +238,9 @@ constexpr auto cli_parsing_error = -3;
 
 /// Parses evmone-bench CLI arguments and registers benchmark cases.
 ///
+/// The --perf-counters, --multithreaded, --block=DIR, --block-fork=NAME
+/// and --replay=FILE options are consumed before.
+///
 /// The following variants of number arguments are supported (including argv[0]):
 ///
 /// 1: evmone-bench
@@ -255,6 +319,49 @@ std::tuple<int, std::vector<BenchmarkCase>> parseargs(int argc, char** argv)
 
     return {0, {}};
 }
+
+/// Registers the benchmarks replaying the host recording file for all registered VMs.
+void register_replay_benchmarks(const fs::path& path)
+{
+    std::ifstream file{path, std::ios::binary};
+    auto recording = state::HostRecording::load(file);
+    if (!recording.has_value())
+        throw std::invalid_argument{"invalid host recording file: " + path.string()};
+
+    const auto shared_recording = std::make_shared<state::HostRecording>(std::move(*recording));
+    for (auto& [vm_name, vm] : registered_vms)
+    {
+        const auto name = std::string{vm_name} + "/replay/" + path.stem().string();
+        RegisterBenchmark(name.c_str(), [&vm_ = vm, shared_recording](State& state) {
+            bench_replay(state, vm_, *shared_recording);
+        })->Unit(kMicrosecond);
+    }
+}
+
+/// Consumes the option flag given in any position. Returns true if it was present.
+bool consume_option(int& argc, char** argv, std::string_view option)
+{
+    const auto end = std::remove(argv + 1, argv + argc, option);
+    if (end == argv + argc)
+        return false;
+    argc = static_cast<int>(end - argv);
+    return true;
+}
+
+/// Consumes the option given as --option=value in any position.
+/// Returns the value of the last occurrence or empty optional if not present.
+std::optional<std::string> consume_option_value(int& argc, char** argv, std::string_view option)
+{
+    std::optional<std::string> value;
+    const auto end = std::remove_if(argv + 1, argv + argc, [&](std::string_view arg) {
+        if (arg.size() <= option.size() || !arg.starts_with(option) || arg[option.size()] != '=')
+            return false;
+        value = arg.substr(option.size() + 1);
+        return true;
+    });
+    argc = static_cast<int>(end - argv);
+    return value;
+}
 }  // namespace
 }  // namespace evmone::test
 
@@ -264,6 +371,19 @@ int main(int argc, char** argv)
     try
     {
         Initialize(&argc, argv);  // Consumes --benchmark_ options.
+        if (consume_option(argc, argv, "--perf-counters"))
+        {
+            perf_counters_enabled = PerfCounters{}.available();
+            if (!perf_counters_enabled)
+            {
+                std::cerr << "Hardware performance counters are not available, "
+                             "ignoring --perf-counters\n";
+            }
+        }
+        multithreaded_enabled = consume_option(argc, argv, "--multithreaded");
+        const auto block_dir = consume_option_value(argc, argv, "--block");
+        const auto block_fork = consume_option_value(argc, argv, "--block-fork");
+        const auto replay_file = consume_option_value(argc, argv, "--replay");
         const auto [ec, benchmark_cases] = parseargs(argc, argv);
         if (ec == cli_parsing_error && ReportUnrecognizedArguments(argc, argv))
             return ec;
@@ -276,6 +396,12 @@ int main(int argc, char** argv)
         registered_vms["bnocgoto"] = evmc::VM{evmc_create_evmone(), {{"cgoto", "no"}}};
         register_benchmarks(benchmark_cases);
         register_synthetic_benchmarks();
+        if (multithreaded_enabled)
+            register_state_mt_benchmarks();
+        if (block_dir.has_value())
+            register_block_benchmark(*block_dir, to_rev(block_fork.value_or("Shanghai")));
+        if (replay_file.has_value())
+            register_replay_benchmarks(*replay_file);
         RunSpecifiedBenchmarks();
         return 0;
     }
@@ -0,0 +1,291 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "block_benchmarks.hpp"
+#include "../state/mpt_hash.hpp"
+#include "../state/state.hpp"
+#include "../statetest/statetest.hpp"
+#include <benchmark/benchmark.h>
+#include <evmc/evmc.hpp>
+#include <evmone/evmone.h>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <fstream>
+#include <memory>
+
+namespace json = nlohmann;
+
+namespace evmone::test
+{
+namespace
+{
+using clock = std::chrono::steady_clock;
+
+/// Adds the time of its lifetime to the given duration.
+class ScopedTimer
+{
+    clock::duration& m_total;
+    const clock::time_point m_start = clock::now();
+
+public:
+    explicit ScopedTimer(clock::duration& total) noexcept : m_total{total} {}
+    ~ScopedTimer() noexcept { m_total += clock::now() - m_start; }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+/// The EVMC VM proxy measuring the time of the top-level executions
+/// and of the host calls accessing the state.
+///
+/// The host "call" (the nested executions and the precompiles) is not timed as the host access.
+/// Every host call is timed separately so this adds a small overhead per host call.
+class TimingVM : public evmc_vm
+{
+    evmc_vm& m_vm;
+
+public:
+    /// The time of the top-level executions (including the host calls).
+    clock::duration execution_time{};
+
+    /// The time of the host calls accessing the state.
+    clock::duration host_time{};
+
+    explicit TimingVM(evmc::VM& vm) noexcept
+      : evmc_vm{EVMC_ABI_VERSION, "timing", "", destroy, execute, get_capabilities, set_option},
+        m_vm{*vm.get_raw_pointer()}
+    {}
+
+private:
+    /// The host proxy forwarding the calls to the host.
+    struct TimingHost
+    {
+        TimingVM& vm;
+        const evmc_host_interface& host;
+        evmc_host_context* context;
+    };
+
+    template <auto Member>
+    struct Timed;
+
+    /// Forwards the host function call measuring its time.
+    template <typename R, typename... Args,
+        R (*evmc_host_interface::*Member)(evmc_host_context*, Args...)>
+    struct Timed<Member>
+    {
+        static R call(evmc_host_context* context, Args... args) noexcept
+        {
+            const auto& h = *reinterpret_cast<const TimingHost*>(context);
+            const ScopedTimer timer{h.vm.host_time};
+            return (h.host.*Member)(h.context, args...);
+        }
+    };
+
+    static evmc_result call(evmc_host_context* context, const evmc_message* msg) noexcept
+    {
+        const auto& h = *reinterpret_cast<const TimingHost*>(context);
+        return h.host.call(h.context, msg);
+    }
+
+    static constexpr evmc_host_interface timing_interface{
+        Timed<&evmc_host_interface::account_exists>::call,
+        Timed<&evmc_host_interface::get_storage>::call,
+        Timed<&evmc_host_interface::set_storage>::call,
+        Timed<&evmc_host_interface::get_balance>::call,
+        Timed<&evmc_host_interface::get_code_size>::call,
+        Timed<&evmc_host_interface::get_code_hash>::call,
+        Timed<&evmc_host_interface::copy_code>::call,
+        Timed<&evmc_host_interface::selfdestruct>::call,
+        call,
+        Timed<&evmc_host_interface::get_tx_context>::call,
+        Timed<&evmc_host_interface::get_block_hash>::call,
+        Timed<&evmc_host_interface::emit_log>::call,
+        Timed<&evmc_host_interface::access_account>::call,
+        Timed<&evmc_host_interface::access_storage>::call,
+    };
+
+    static void destroy(evmc_vm* /*vm*/) noexcept {}
+
+    static evmc_result execute(evmc_vm* vm, const evmc_host_interface* host,
+        evmc_host_context* context, evmc_revision rev, const evmc_message* msg,
+        const uint8_t* code, size_t code_size) noexcept
+    {
+        auto& self = *static_cast<TimingVM*>(vm);
+        TimingHost timing_host{self, *host, context};
+        auto* const timing_context = reinterpret_cast<evmc_host_context*>(&timing_host);
+
+        auto& inner = self.m_vm;
+        if (msg->depth != 0)
+            return inner.execute(&inner, &timing_interface, timing_context, rev, msg, code,
+                code_size);
+
+        const ScopedTimer timer{self.execution_time};
+        return inner.execute(
+            &inner, &timing_interface, timing_context, rev, msg, code, code_size);
+    }
+
+    static evmc_capabilities_flagset get_capabilities(evmc_vm* vm) noexcept
+    {
+        auto& inner = static_cast<TimingVM*>(vm)->m_vm;
+        return inner.get_capabilities(&inner);
+    }
+
+    static evmc_set_option_result set_option(
+        evmc_vm* vm, const char* name, const char* value) noexcept
+    {
+        auto& inner = static_cast<TimingVM*>(vm)->m_vm;
+        return inner.set_option(&inner, name, value);
+    }
+};
+
+/// The t8n-style block fixture.
+struct BlockFixture
+{
+    evmc_revision rev = EVMC_SHANGHAI;
+    state::State pre_state;
+    state::BlockInfo block;
+    std::vector<state::Transaction> transactions;
+};
+
+json::json load_json(const std::filesystem::path& path)
+{
+    std::ifstream file{path};
+    if (!file)
+        throw std::runtime_error{"cannot open " + path.string()};
+    return json::json::parse(file);
+}
+
+BlockFixture load_block_fixture(const std::filesystem::path& dir, evmc_revision rev)
+{
+    BlockFixture fixture;
+    fixture.rev = rev;
+    fixture.pre_state = from_json<state::State>(load_json(dir / "alloc.json"));
+    fixture.block = from_json<state::BlockInfo>(load_json(dir / "env.json"));
+    for (const auto& j_tx : load_json(dir / "txs.json"))
+        fixture.transactions.emplace_back(from_json<state::Transaction>(j_tx));
+    return fixture;
+}
+
+/// The results of the block executions summed over the benchmark iterations.
+struct BlockTotals
+{
+    int64_t gas_used = 0;
+    int64_t num_transactions = 0;
+    int64_t num_rejected = 0;
+};
+
+/// Executes all the transactions of the block and finalizes the block.
+void execute_block(
+    state::State& block_state, BlockFixture& fixture, evmc::VM& vm, BlockTotals& totals)
+{
+    for (const auto& tx : fixture.transactions)
+    {
+        const auto res = state::transition(block_state, fixture.block, tx, fixture.rev, vm);
+        if (const auto* receipt = std::get_if<state::TransactionReceipt>(&res))
+        {
+            totals.gas_used += receipt->gas_used;
+            ++totals.num_transactions;
+        }
+        else
+            ++totals.num_rejected;
+    }
+    state::finalize(
+        block_state, fixture.rev, fixture.block.coinbase, std::nullopt, fixture.block.withdrawals);
+}
+
+/// Reports the gas rate and the transaction rate.
+void report_block_totals(benchmark::State& state, const BlockTotals& totals)
+{
+    if (totals.num_rejected != 0)
+    {
+        state.SkipWithError(
+            ("rejected transactions: " + std::to_string(totals.num_rejected)).c_str());
+    }
+
+    using benchmark::Counter;
+    state.counters["gas_rate"] = Counter(static_cast<double>(totals.gas_used), Counter::kIsRate);
+    state.counters["tx_rate"] =
+        Counter(static_cast<double>(totals.num_transactions), Counter::kIsRate);
+}
+
+/// Executes all the transactions of the block, finalizes the block and computes the state root.
+void bench_block(benchmark::State& state, BlockFixture& fixture)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    BlockTotals totals;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        auto block_state = fixture.pre_state;
+        state.ResumeTiming();
+
+        execute_block(block_state, fixture, vm, totals);
+        const auto state_root = state::mpt_hash(block_state.get_accounts());
+        benchmark::DoNotOptimize(state_root);
+    }
+
+    report_block_totals(state, totals);
+}
+
+/// Runs the block like bench_block() and additionally reports the time split per block:
+/// the EVM execution, the host state access during the execution, the rest of the transaction
+/// processing, and the state root hashing.
+///
+/// Every host call is timed, so the rates include the timing overhead
+/// and should be taken from bench_block().
+void bench_block_split(benchmark::State& state, BlockFixture& fixture)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    TimingVM timing_vm{vm};
+    evmc::VM timed_vm{&timing_vm};  // TimingVM::destroy() does nothing.
+
+    clock::duration transition_time{};
+    clock::duration state_root_time{};
+    BlockTotals totals;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        auto block_state = fixture.pre_state;
+        state.ResumeTiming();
+
+        {
+            const ScopedTimer timer{transition_time};
+            execute_block(block_state, fixture, timed_vm, totals);
+        }
+
+        const ScopedTimer timer{state_root_time};
+        const auto state_root = state::mpt_hash(block_state.get_accounts());
+        benchmark::DoNotOptimize(state_root);
+    }
+
+    report_block_totals(state, totals);
+
+    const auto ns = [](clock::duration d) {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    };
+
+    using benchmark::Counter;
+    state.counters["execution_ns"] =
+        Counter(ns(timing_vm.execution_time - timing_vm.host_time), Counter::kAvgIterations);
+    state.counters["host_ns"] = Counter(ns(timing_vm.host_time), Counter::kAvgIterations);
+    state.counters["tx_overhead_ns"] =
+        Counter(ns(transition_time - timing_vm.execution_time), Counter::kAvgIterations);
+    state.counters["state_root_ns"] = Counter(ns(state_root_time), Counter::kAvgIterations);
+}
+}  // namespace
+
+void register_block_benchmark(const std::filesystem::path& dir, evmc_revision rev)
+{
+    auto fixture = std::make_shared<BlockFixture>(load_block_fixture(dir, rev));
+    const auto name = (dir / "").parent_path().filename().string();
+    benchmark::RegisterBenchmark(("block/" + name).c_str(), [fixture](benchmark::State& state) {
+        bench_block(state, *fixture);
+    })->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("block_split/" + name).c_str(),
+        [fixture](benchmark::State& state) { bench_block_split(state, *fixture); })
+        ->Unit(benchmark::kMillisecond);
+}
+}  // namespace evmone::test
@@ -0,0 +1,16 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <evmc/evmc.h>
+#include <filesystem>
+
+namespace evmone::test
+{
+/// Registers the block benchmarks executing the transactions of the t8n-style fixture
+/// (alloc.json, env.json, txs.json files in the given directory) with state::transition():
+/// block/NAME reporting the gas and transaction rates, and block_split/NAME additionally
+/// reporting the time split measured by timing every host call.
+void register_block_benchmark(const std::filesystem::path& dir, evmc_revision rev);
+}  // namespace evmone::test
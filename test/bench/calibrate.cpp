@@ -0,0 +1,273 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+/// @file
+/// Measures the execution time per gas unit of individual instructions and reports the ones
+/// deviating from the median, i.e. the candidates for being underpriced (DoS-prone)
+/// or overpriced.
+///
+/// Every instruction is executed in the synthetic benchmark loop. The instructions accessing
+/// the state and calling precompiles are executed with the state transition Host.
+/// The precompiles not implemented there are not measured. The instructions accessing
+/// the accounts or the storage are measured twice: starting every execution with the state
+/// access status cold and with the state already warmed up by a previous execution.
+///
+/// Usage: evmone-calibrate [--factor F] [--min-time SECONDS] [--filter SUBSTRING]
+///
+/// The exit code is 1 if any instruction is underpriced by more than the factor.
+
+#include "synthetic_code.hpp"
+#include "test/state/host.hpp"
+#include "test/utils/bytecode.hpp"
+#include <evmc/evmc.hpp>
+#include <evmone/evmone.h>
+#include <evmone/instructions_traits.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+using namespace evmone::test;
+using namespace evmc::literals;
+namespace state = evmone::state;
+
+constexpr auto rev = EVMC_SHANGHAI;
+constexpr auto contract = 0xc0de_address;
+constexpr auto sender = 0x5e4d_address;
+constexpr int64_t gas_limit = 1'000'000'000;
+
+/// The state access status at the start of the measured execution.
+enum class Access
+{
+    cold,  ///< The execution starts with a fresh state.
+    warm,  ///< The execution starts with the state left by the previous execution.
+};
+
+const char* to_string(Access access) noexcept
+{
+    return (access == Access::cold) ? "cold" : "warm";
+}
+
+struct Case
+{
+    std::string name;
+    bytecode code;
+    bool accesses_state = false;  ///< The gas cost depends on the state access status.
+};
+
+struct Measurement
+{
+    std::string name;
+    Access access = Access::warm;
+    int64_t gas_used = 0;    ///< The gas used by single execution.
+    double time = 0;         ///< The time of single execution in nanoseconds.
+    double time_per_gas = 0;
+};
+
+/// Calls the precompile with the zero input of the given size.
+bytecode call_precompile(uint8_t precompile, int input_size)
+{
+    return push(32) + push(0) + push(static_cast<uint64_t>(input_size)) + push(0) +
+           push(precompile) + OP_GAS + OP_STATICCALL + OP_POP;
+}
+
+std::vector<Case> get_cases()
+{
+    std::vector<Case> cases;
+
+    // The instructions supported by the synthetic benchmark generator.
+    for (const auto& params : get_synthetic_code_params())
+    {
+        if (params.mode == Mode::min_stack)
+        {
+            cases.push_back({evmone::instr::traits[params.opcode].name,
+                generate_loop_v2(generate_loop_inner_code(params))});
+        }
+    }
+
+    // The instructions accessing memory, the state, or calling precompiles,
+    // repeated in the loop body.
+    const auto add = [&cases](std::string name, int n, const bytecode& inner,
+                         bool accesses_state = false) {
+        cases.push_back({std::move(name), generate_loop_v2(n * inner), accesses_state});
+    };
+    add("MLOAD", 64, push(0) + OP_MLOAD + OP_POP);
+    add("MSTORE", 64, mstore(0, 0));
+    add("MSTORE8", 64, mstore8(0, 0));
+    add("MSTORE/expand", 16, OP_MSIZE + OP_DUP1 + OP_MSTORE);  // Memory grows by 32 bytes.
+    add("KECCAK256/32", 64, keccak256(0, 32) + OP_POP);
+    add("KECCAK256/1024", 16, keccak256(0, 1024) + OP_POP);
+    add("CALLDATACOPY/32", 64, push(32) + push(0) + push(0) + OP_CALLDATACOPY);
+    add("CODECOPY/32", 64, push(32) + push(0) + push(0) + OP_CODECOPY);
+    add("SLOAD", 64, sload(0) + OP_POP, true);
+    add("SSTORE", 64, sstore(0, 1), true);
+    add("BALANCE", 64, OP_ADDRESS + OP_BALANCE + OP_POP, true);
+    add("SELFBALANCE", 64, OP_SELFBALANCE + OP_POP);
+    add("EXTCODESIZE", 64, OP_ADDRESS + OP_EXTCODESIZE + OP_POP, true);
+    add("EXTCODEHASH", 64, OP_ADDRESS + OP_EXTCODEHASH + OP_POP, true);
+    add("EXTCODECOPY/32", 64, push(32) + push(0) + push(0) + OP_ADDRESS + OP_EXTCODECOPY,
+        true);
+    add("BLOCKHASH", 64, push(0) + OP_BLOCKHASH + OP_POP);
+    add("LOG0", 16, push(0) + push(0) + OP_LOG0);
+    add("LOG4/32", 16, push(0) + push(0) + push(0) + push(0) + push(32) + push(0) + OP_LOG4);
+    add("CALL/empty", 16,
+        push(0) + push(0) + push(0) + push(0) + push(0) + push(0xdead) + OP_GAS + OP_CALL + OP_POP,
+        true);
+    // Only the identity precompile is implemented in the state transition Host,
+    // the others fail with EVMC_INTERNAL_ERROR.
+    add("STATICCALL/identity", 16, call_precompile(0x04, 32));
+    return cases;
+}
+
+/// Executes the code repeatedly for at least the min_time and returns the average.
+///
+/// For the cold access every execution starts with a fresh state, which is created outside
+/// of the measured time. For the warm access the state is warmed up by an unmeasured execution.
+/// All measured executions must use the same amount of gas.
+Measurement measure(evmc::VM& vm, const Case& c, Access access, double min_time)
+{
+    const auto create_state = [&c] {
+        state::State state;
+        state.insert(contract).code = c.code;
+        state.insert(sender).balance = 1'000'000'000;
+        return state;
+    };
+    auto state = create_state();
+    const state::BlockInfo block{};
+    state::Transaction tx{};
+    tx.gas_limit = gas_limit;
+    tx.sender = sender;
+    tx.to = contract;
+
+    evmc_message msg{};
+    msg.gas = gas_limit;
+    msg.recipient = contract;
+    msg.code_address = contract;
+    msg.sender = sender;
+
+    const auto execute = [&] {
+        state::Host host{rev, vm, state, block, tx};
+        const auto r = vm.execute(host, rev, msg, c.code.data(), c.code.size());
+        if (r.status_code != EVMC_SUCCESS)
+        {
+            throw std::runtime_error{
+                c.name + ": execution failed with status " + std::to_string(r.status_code)};
+        }
+        return gas_limit - r.gas_left;
+    };
+
+    if (access == Access::warm)
+        execute();  // Warm up the caches and the state access status.
+
+    using clock = std::chrono::steady_clock;
+    int64_t gas_used = 0;
+    int64_t n = 0;
+    std::chrono::duration<double, std::nano> elapsed{};
+    do
+    {
+        if (access == Access::cold)
+            state = create_state();
+
+        const auto start = clock::now();
+        const auto execution_gas_used = execute();
+        elapsed += clock::now() - start;
+
+        if (n == 0)
+            gas_used = execution_gas_used;
+        else if (execution_gas_used != gas_used)
+            throw std::runtime_error{c.name + ": gas used differs between executions"};
+        ++n;
+    } while (elapsed.count() < min_time * 1e9);
+
+    const auto time = elapsed.count() / static_cast<double>(n);
+    return {c.name, access, gas_used, time, time / static_cast<double>(gas_used)};
+}
+
+int run(double factor, double min_time, std::string_view filter)
+{
+    evmc::VM vm{evmc_create_evmone()};
+
+    std::vector<Measurement> results;
+    for (const auto& c : get_cases())
+    {
+        if (c.name.find(filter) == std::string::npos)
+            continue;
+        if (c.accesses_state)
+            results.push_back(measure(vm, c, Access::cold, min_time));
+        results.push_back(measure(vm, c, Access::warm, min_time));
+    }
+    if (results.empty())
+        throw std::runtime_error{"no instructions matching the filter"};
+
+    std::vector<double> ratios;
+    for (const auto& r : results)
+        ratios.push_back(r.time_per_gas);
+    std::nth_element(ratios.begin(), ratios.begin() + std::ssize(ratios) / 2, ratios.end());
+    const auto median = ratios[ratios.size() / 2];
+
+    int num_underpriced = 0;
+    std::cout << "instruction,access,gas,ns,ns_per_gas,ratio_to_median,flag\n" << std::fixed;
+    for (const auto& r : results)
+    {
+        const auto ratio = r.time_per_gas / median;
+        const char* flag = "";
+        if (ratio > factor)
+        {
+            flag = "UNDERPRICED";
+            ++num_underpriced;
+        }
+        else if (ratio < 1 / factor)
+            flag = "OVERPRICED";
+
+        std::cout << r.name << ',' << to_string(r.access) << ',' << r.gas_used << ','
+                  << std::setprecision(0) << r.time << ',' << std::setprecision(4)
+                  << r.time_per_gas << ',' << std::setprecision(2) << ratio << ',' << flag << '\n';
+    }
+
+    std::cerr << "median: " << std::setprecision(4) << median << " ns/gas, " << num_underpriced
+              << " instruction(s) slower than " << factor << "x the median\n";
+    return num_underpriced != 0 ? 1 : 0;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        double factor = 3;
+        double min_time = 0.2;
+        std::string filter;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string_view arg{argv[i]};
+            if (arg == "--factor" && i + 1 < argc)
+                factor = std::stod(argv[++i]);
+            else if (arg == "--min-time" && i + 1 < argc)
+                min_time = std::stod(argv[++i]);
+            else if (arg == "--filter" && i + 1 < argc)
+                filter = argv[++i];
+            else
+            {
+                std::cerr << "usage: " << argv[0]
+                          << " [--factor F] [--min-time SECONDS] [--filter SUBSTRING]\n";
+                return 2;
+            }
+        }
+        if (factor <= 1)
+            throw std::invalid_argument{"the factor must be greater than 1"};
+
+        return run(factor, min_time, filter);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << ex.what() << "\n";
+        return 2;
+    }
+}
@@ -3,6 +3,9 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+#include "perf_counters.hpp"
+#include "test/state/host.hpp"
+#include "test/state/host_recording.hpp"
 #include "test/utils/utils.hpp"
 #include <benchmark/benchmark.h>
 #include <evmc/evmc.hpp>
@@ -11,7 +14,9 @@
 #include <evmone/advanced_execution.hpp>
 #include <evmone/baseline.hpp>
 #include <evmone/eof.hpp>
+#include <evmone/evmone.h>
 #include <evmone/vm.hpp>
+#include <chrono>
 
 namespace evmone::test
 {
@@ -20,6 +25,13 @@ extern std::map<std::string_view, evmc::VM> registered_vms;
 constexpr auto default_revision = EVMC_ISTANBUL;
 constexpr auto default_gas_limit = std::numeric_limits<int64_t>::max();
 
+/// Returns the revision the code is benchmarked in.
+/// The EOF code is executed in the first revision supporting it.
+inline evmc_revision get_revision(bytes_view code) noexcept
+{
+    return is_eof_container(code) ? EVMC_CANCUN : default_revision;
+}
+
 
 template <typename ExecutionStateT, typename AnalysisT>
 using ExecuteFn = evmc::Result(evmc::VM& vm, ExecutionStateT& exec_state, const AnalysisT&,
@@ -37,6 +49,8 @@ struct FakeCodeAnalysis
 
 inline advanced::AdvancedCodeAnalysis advanced_analyse(evmc_revision rev, bytes_view code)
 {
+    if (is_eof_container(code))
+        return advanced::analyze_eof1(rev, code);
     return advanced::analyze(rev, code);
 }
 
@@ -92,13 +106,47 @@ inline void bench_analyse(benchmark::State& state, evmc_revision rev, bytes_view
     state.counters["rate"] = Counter(static_cast<double>(bytes_analysed), Counter::kIsRate);
 }
 
+inline void bench_validate_eof(benchmark::State& state, evmc_revision rev, bytes_view code) noexcept
+{
+    auto bytes_validated = uint64_t{0};
+    for (auto _ : state)
+    {
+        auto r = validate_eof(rev, code);
+        benchmark::DoNotOptimize(&r);
+        bytes_validated += code.size();
+    }
+
+    if (validate_eof(rev, code) != EOFValidationError::success)
+        state.SkipWithError("invalid EOF container");
+
+    using benchmark::Counter;
+    state.counters["size"] = Counter(static_cast<double>(code.size()));
+    state.counters["rate"] = Counter(static_cast<double>(bytes_validated), Counter::kIsRate);
+}
+
+
+/// Reports the values of the available hardware performance counters per benchmark iteration.
+inline void report_perf_counters(benchmark::State& state, const PerfCounters& perf_counters)
+{
+    using benchmark::Counter;
+    const auto values = perf_counters.read();
+    for (size_t i = 0; i < PerfCounters::num_events; ++i)
+    {
+        if (values[i].has_value())
+        {
+            state.counters[PerfCounters::names[i]] =
+                Counter(static_cast<double>(*values[i]), Counter::kAvgIterations);
+        }
+    }
+}
+
 
 template <typename ExecutionStateT, typename AnalysisT,
     ExecuteFn<ExecutionStateT, AnalysisT> execute_fn, AnalyseFn<AnalysisT> analyse_fn>
 inline void bench_execute(benchmark::State& state, evmc::VM& vm, bytes_view code, bytes_view input,
     bytes_view expected_output) noexcept
 {
-    constexpr auto rev = default_revision;
+    const auto rev = get_revision(code);
     constexpr auto gas_limit = default_gas_limit;
 
     const auto analysis = analyse_fn(rev, code);
@@ -133,12 +181,184 @@ inline void bench_execute(benchmark::State& state, evmc::VM& vm, bytes_view code
 
     auto total_gas_used = int64_t{0};
     auto iteration_gas_used = int64_t{0};
+    std::optional<PerfCounters> perf_counters;
+    if (perf_counters_enabled)
+    {
+        perf_counters.emplace();
+        perf_counters->start();
+    }
     for (auto _ : state)
     {
         const auto r = execute_fn(vm, exec_state, analysis, msg, rev, host, code);
         iteration_gas_used = gas_limit - r.gas_left;
         total_gas_used += iteration_gas_used;
     }
+    if (perf_counters.has_value())
+    {
+        perf_counters->stop();
+        report_perf_counters(state, *perf_counters);
+    }
+
+    using benchmark::Counter;
+    state.counters["gas_used"] = Counter(static_cast<double>(iteration_gas_used));
+    state.counters["gas_rate"] = Counter(static_cast<double>(total_gas_used), Counter::kIsRate);
+}
+
+
+/// Runs the execution concurrently in all benchmark threads to measure the throughput scaling.
+///
+/// The execute function returns the gas used by a single execution. Reports the aggregate
+/// gas_rate and the scaling efficiency: the average per-thread gas rate relative to
+/// the single-thread gas rate. In the multi-threaded runs the single-thread rate is measured
+/// by the first thread before the benchmark loop, while the other threads wait at its start,
+/// so the efficiency does not depend on which other benchmarks have been run.
+template <typename ExecuteFn>
+void bench_mt(benchmark::State& state, ExecuteFn execute)
+{
+    using clock = std::chrono::steady_clock;
+
+    // Written by the first thread before the benchmark loop and read after it.
+    // The benchmark threads synchronize at the start and the end of the loop.
+    static double single_thread_rate = 0;
+
+    if (state.threads() > 1 && state.thread_index() == 0)
+    {
+        constexpr std::chrono::milliseconds min_time{20};
+        int64_t gas_used = 0;
+        const auto start_time = clock::now();
+        std::chrono::duration<double> elapsed{};
+        do
+        {
+            gas_used += execute();
+            elapsed = clock::now() - start_time;
+        } while (elapsed < min_time);
+        single_thread_rate = static_cast<double>(gas_used) / elapsed.count();
+    }
+
+    auto total_gas_used = int64_t{0};
+    const auto start_time = clock::now();
+    for (auto _ : state)
+        total_gas_used += execute();
+    const auto elapsed = std::chrono::duration<double>(clock::now() - start_time).count();
+    const auto thread_rate = static_cast<double>(total_gas_used) / elapsed;
+
+    using benchmark::Counter;
+    state.counters["gas_rate"] = Counter(static_cast<double>(total_gas_used), Counter::kIsRate);
+    const auto base_rate = (state.threads() == 1) ? thread_rate : single_thread_rate;
+    state.counters["efficiency"] = Counter(thread_rate / base_rate, Counter::kAvgThreads);
+}
+
+/// Executes the code with the baseline interpreter concurrently in all benchmark threads.
+///
+/// The threads share the given VM or, if it is null, each thread creates its own VM instance.
+/// Each thread has its own execution state, code analysis and host.
+inline void bench_baseline_execute_mt(
+    benchmark::State& state, evmc::VM* shared_vm, bytes_view code, bytes_view input) noexcept
+{
+    std::optional<evmc::VM> own_vm;
+    if (shared_vm == nullptr)
+        own_vm.emplace(evmc_create_evmone());
+    auto& vm = (shared_vm != nullptr) ? *shared_vm : *own_vm;
+
+    const auto rev = get_revision(code);
+    constexpr auto gas_limit = default_gas_limit;
+
+    const auto analysis = baseline_analyse(rev, code);
+    evmc::MockedHost host;
+    ExecutionState exec_state;
+    evmc_message msg{};
+    msg.kind = EVMC_CALL;
+    msg.gas = gas_limit;
+    msg.input_data = input.data();
+    msg.input_size = input.size();
+
+    if (const auto r = baseline_execute(vm, exec_state, analysis, msg, rev, host, code);
+        r.status_code != EVMC_SUCCESS)
+    {
+        state.SkipWithError(("failure: " + std::to_string(r.status_code)).c_str());
+        return;
+    }
+
+    bench_mt(state, [&] {
+        const auto r = baseline_execute(vm, exec_state, analysis, msg, rev, host, code);
+        return gas_limit - r.gas_left;
+    });
+}
+
+/// Executes the code with the state transition Host concurrently in all benchmark threads.
+///
+/// Unlike the MockedHost, the state::Host executes the nested calls, including the precompiles
+/// sharing the process-wide precompile results cache. The threads share the given VM or,
+/// if it is null, each thread creates its own VM instance. Each thread has its own state.
+inline void bench_state_execute_mt(
+    benchmark::State& state, evmc::VM* shared_vm, bytes_view code) noexcept
+{
+    using namespace evmc::literals;
+    constexpr auto rev = EVMC_SHANGHAI;
+    constexpr auto contract = 0xc0de_address;
+    constexpr auto sender = 0x5e4d_address;
+    constexpr int64_t gas_limit = 1'000'000'000;
+
+    std::optional<evmc::VM> own_vm;
+    if (shared_vm == nullptr)
+        own_vm.emplace(evmc_create_evmone());
+    auto& vm = (shared_vm != nullptr) ? *shared_vm : *own_vm;
+
+    state::State host_state;
+    host_state.insert(contract).code = code;
+    host_state.insert(sender).balance = gas_limit;
+    const state::BlockInfo block{};
+    state::Transaction tx{};
+    tx.gas_limit = gas_limit;
+    tx.sender = sender;
+    tx.to = contract;
+
+    evmc_message msg{};
+    msg.gas = gas_limit;
+    msg.recipient = contract;
+    msg.code_address = contract;
+    msg.sender = sender;
+
+    const auto execute = [&] {
+        state::Host host{rev, vm, host_state, block, tx};
+        return vm.execute(host, rev, msg, code.data(), code.size());
+    };
+
+    if (const auto r = execute(); r.status_code != EVMC_SUCCESS)
+    {
+        state.SkipWithError(("failure: " + std::to_string(r.status_code)).c_str());
+        return;
+    }
+
+    bench_mt(state, [&] { return gas_limit - execute().gas_left; });
+}
+
+
+/// Executes the recorded top-level execution with the host serving the recorded host calls.
+inline void bench_replay(
+    benchmark::State& state, evmc::VM& vm, const state::HostRecording& recording) noexcept
+{
+    state::ReplayHost host{recording};
+    const auto& msg = recording.msg;
+    const auto execute = [&] {
+        host.rewind();
+        return vm.execute(host, recording.rev, msg, recording.code.data(), recording.code.size());
+    };
+
+    if (execute(); host.diverged())  // Test run.
+    {
+        state.SkipWithError("execution diverged from the recording");
+        return;
+    }
+
+    auto total_gas_used = int64_t{0};
+    auto iteration_gas_used = int64_t{0};
+    for (auto _ : state)
+    {
+        const auto r = execute();
+        iteration_gas_used = msg.gas - r.gas_left;
+        total_gas_used += iteration_gas_used;
+    }
 
     using benchmark::Counter;
     state.counters["gas_used"] = Counter(static_cast<double>(iteration_gas_used));
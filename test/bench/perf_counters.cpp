@@ -0,0 +1,150 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "perf_counters.hpp"
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace evmone::test
+{
+bool perf_counters_enabled = false;
+
+#ifdef __linux__
+namespace
+{
+constexpr uint64_t cache_miss_event(perf_hw_cache_id cache) noexcept
+{
+    return uint64_t{cache} | (uint64_t{PERF_COUNT_HW_CACHE_OP_READ} << 8) |
+           (uint64_t{PERF_COUNT_HW_CACHE_RESULT_MISS} << 16);
+}
+
+/// The perf event (type, config) pairs in the order of PerfCounters::names.
+constexpr std::pair<uint32_t, uint64_t> events[PerfCounters::num_events]{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, cache_miss_event(PERF_COUNT_HW_CACHE_L1I)},
+    {PERF_TYPE_HW_CACHE, cache_miss_event(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, cache_miss_event(PERF_COUNT_HW_CACHE_ITLB)},
+};
+
+int open_event(uint32_t type, uint64_t config) noexcept
+{
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // Count in the calling thread on any CPU.
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+}  // namespace
+
+PerfCounters::PerfCounters() noexcept
+{
+    for (size_t i = 0; i < num_events; ++i)
+        m_fds[i] = open_event(events[i].first, events[i].second);
+}
+
+PerfCounters::~PerfCounters() noexcept
+{
+    for (const auto fd : m_fds)
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+
+bool PerfCounters::available() const noexcept
+{
+    for (const auto fd : m_fds)
+    {
+        if (fd >= 0)
+            return true;
+    }
+    return false;
+}
+
+void PerfCounters::start() noexcept
+{
+    for (const auto fd : m_fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfCounters::stop() noexcept
+{
+    for (const auto fd : m_fds)
+    {
+        if (fd >= 0)
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+}
+
+PerfCounters::Values PerfCounters::read() const noexcept
+{
+    Values values;
+    for (size_t i = 0; i < num_events; ++i)
+    {
+        if (m_fds[i] < 0)
+            continue;
+
+        // The layout for PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING.
+        struct
+        {
+            uint64_t value;
+            uint64_t time_enabled;
+            uint64_t time_running;
+        } data{};
+        if (::read(m_fds[i], &data, sizeof(data)) != sizeof(data))
+            continue;
+
+        if (data.time_running != 0 && data.time_running < data.time_enabled)
+        {
+            // The counter was multiplexed with other events: extrapolate the value.
+            data.value = static_cast<uint64_t>(static_cast<double>(data.value) *
+                                               static_cast<double>(data.time_enabled) /
+                                               static_cast<double>(data.time_running));
+        }
+        values[i] = data.value;
+    }
+    return values;
+}
+#else
+PerfCounters::PerfCounters() noexcept
+{
+    m_fds.fill(-1);
+}
+
+PerfCounters::~PerfCounters() noexcept = default;
+
+bool PerfCounters::available() const noexcept
+{
+    return false;
+}
+
+void PerfCounters::start() noexcept {}
+
+void PerfCounters::stop() noexcept {}
+
+PerfCounters::Values PerfCounters::read() const noexcept
+{
+    return {};
+}
+#endif
+}  // namespace evmone::test
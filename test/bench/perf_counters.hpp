@@ -0,0 +1,55 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace evmone::test
+{
+/// Enables the hardware performance counters in the execution benchmarks.
+/// Set by the --perf-counters command line option of evmone-bench.
+extern bool perf_counters_enabled;
+
+/// The set of hardware performance counters of the current thread.
+///
+/// Uses Linux perf_event_open(). The counters not supported by the system
+/// (e.g. in a VM or because of the perf_event_paranoid setting) are skipped.
+/// On other systems all the counters are unavailable.
+class PerfCounters
+{
+public:
+    static constexpr size_t num_events = 6;
+
+    /// The names of the counters as reported in the benchmark results.
+    static constexpr std::array<const char*, num_events> names{
+        "instructions", "cycles", "branch_misses", "L1i_misses", "L1d_misses", "iTLB_misses"};
+
+    using Values = std::array<std::optional<uint64_t>, num_events>;
+
+    PerfCounters() noexcept;
+    ~PerfCounters() noexcept;
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /// Returns true if at least one counter is available.
+    [[nodiscard]] bool available() const noexcept;
+
+    /// Resets the counters and starts counting.
+    void start() noexcept;
+
+    /// Stops counting.
+    void stop() noexcept;
+
+    /// Reads the counter values. The values of the unavailable counters are empty.
+    /// The values are scaled if the counters were multiplexed by the kernel.
+    [[nodiscard]] Values read() const noexcept;
+
+private:
+    std::array<int, num_events> m_fds;
+};
+}  // namespace evmone::test
@@ -0,0 +1,53 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2020 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include "test/utils/bytecode.hpp"
+#include <string>
+#include <tuple>
+#include <vector>
+
+/// @file
+/// The generator of the synthetic benchmark code: loops of repeated single instructions.
+
+namespace evmone::test
+{
+enum class Mode
+{
+    min_stack = 0,   ///< The code uses as minimal stack as possible.
+    full_stack = 1,  ///< The code fills the stack up to its limit.
+};
+
+/// The parameters of the generated code.
+struct CodeParams
+{
+    Opcode opcode;
+    Mode mode;
+};
+
+/// The less-than comparison operator. Needed for std::map.
+inline constexpr bool operator<(const CodeParams& a, const CodeParams& b) noexcept
+{
+    return std::tuple(a.opcode, a.mode) < std::tuple(b.opcode, b.mode);
+}
+
+/// Returns the name of the generated code: the opcode name, the instruction category and the mode.
+std::string to_string(const CodeParams& params);
+
+/// Generates the EVM benchmark loop inner code for the given opcode and "mode".
+/// Returns empty code if the combination is not supported.
+bytecode generate_loop_inner_code(CodeParams params);
+
+/// Generates a benchmark loop of 255 iterations with given inner code.
+/// The inner code is allowed to duplicate the loop counter on the stack top,
+/// but must not modify it.
+bytecode generate_loop_v1(const bytecode& inner_code);
+
+/// Generates a benchmark loop of 255 iterations with given inner code.
+/// Faster variant of generate_loop_v1() with the same instructions and gas.
+bytecode generate_loop_v2(const bytecode& inner_code);
+
+/// Returns the list of all supported code parameters.
+std::vector<CodeParams> get_synthetic_code_params();
+}  // namespace evmone::test
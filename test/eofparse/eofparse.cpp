@@ -4,8 +4,17 @@
 
 #include <evmc/evmc.hpp>
 #include <evmone/eof.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace
 {
@@ -33,12 +42,156 @@ std::optional<evmc::bytes> from_hex_skip_nonalnum(InputIterator begin, InputIter
     return bs;
 }
 
+/// The corpus of EOF containers for the batch validation.
+struct Corpus
+{
+    std::vector<evmc::bytes> containers;
+    size_t num_invalid_hex = 0;  ///< The number of corpus lines not being valid hex.
+};
+
+/// Loads the corpus of hex-encoded containers, one per line.
+/// Empty lines and lines starting with # are skipped.
+Corpus load_hex_corpus(std::istream& in)
+{
+    Corpus corpus;
+    for (std::string line; std::getline(in, line);)
+    {
+        if (line.empty() || line.starts_with('#'))
+            continue;
+
+        if (auto o = from_hex_skip_nonalnum(line.begin(), line.end()); o)
+            corpus.containers.emplace_back(std::move(*o));
+        else
+            ++corpus.num_invalid_hex;
+    }
+    return corpus;
+}
+
+/// Loads the corpus of binary containers, each prefixed with its length
+/// as 4-byte big-endian number.
+Corpus load_binary_corpus(std::istream& in)
+{
+    const std::string data{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    const auto* p = reinterpret_cast<const uint8_t*>(data.data());
+    const auto* const end = p + data.size();
+
+    Corpus corpus;
+    while (p != end)
+    {
+        if (end - p < 4)
+            throw std::runtime_error{"truncated container length"};
+        const auto len = size_t{p[0]} << 24 | size_t{p[1]} << 16 | size_t{p[2]} << 8 | p[3];
+        p += 4;
+        if (static_cast<size_t>(end - p) < len)
+            throw std::runtime_error{"truncated container"};
+        corpus.containers.emplace_back(p, len);
+        p += len;
+    }
+    return corpus;
+}
+
+/// Validates all containers of the corpus in parallel and reports throughput and
+/// the histogram of the validation results.
+///
+/// The threads take the containers in small chunks from the shared counter
+/// so the work is balanced even if the container sizes differ a lot.
+void validate_batch(const Corpus& corpus, unsigned num_threads)
+{
+    using evmone::EOFValidationError;
+    static constexpr size_t chunk_size = 64;
+
+    const auto& containers = corpus.containers;
+    std::vector<EOFValidationError> results(containers.size());
+    std::atomic<size_t> next_chunk = 0;
+
+    const auto worker = [&]() noexcept {
+        for (size_t begin; (begin = next_chunk.fetch_add(chunk_size)) < containers.size();)
+        {
+            const auto end = std::min(begin + chunk_size, containers.size());
+            for (auto i = begin; i < end; ++i)
+                results[i] = evmone::validate_eof(EVMC_CANCUN, containers[i]);
+        }
+    };
+
+    const auto start_time = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < num_threads; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+    const auto duration =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    size_t total_size = 0;
+    for (const auto& c : containers)
+        total_size += c.size();
+
+    std::array<size_t, static_cast<size_t>(EOFValidationError::impossible) + 1> histogram{};
+    for (const auto r : results)
+        ++histogram[static_cast<size_t>(r)];
+
+    std::cout << "containers: " << containers.size() << "\n";
+    std::cout << "bytes: " << total_size << "\n";
+    std::cout << "threads: " << num_threads << "\n";
+    std::cout << "time: " << duration << " s\n";
+    std::cout << "throughput: " << static_cast<double>(containers.size()) / duration
+              << " containers/s, " << static_cast<double>(total_size) / duration / 1e6
+              << " MB/s\n";
+    if (corpus.num_invalid_hex != 0)
+        std::cout << "invalid_hex: " << corpus.num_invalid_hex << "\n";
+    for (size_t i = 0; i < histogram.size(); ++i)
+    {
+        if (histogram[i] != 0)
+        {
+            std::cout << evmone::get_error_message(static_cast<EOFValidationError>(i)) << ": "
+                      << histogram[i] << "\n";
+        }
+    }
+}
+
+/// Runs the batch validation mode:
+///   evmone-eofparse --batch corpus_file [--binary] [--threads N]
+int main_batch(int argc, char* argv[])
+{
+    std::string corpus_file;
+    bool binary = false;
+    unsigned num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg{argv[i]};
+        if (arg == "--batch" && i + 1 < argc)
+            corpus_file = argv[++i];
+        else if (arg == "--binary")
+            binary = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            num_threads = static_cast<unsigned>(std::max(std::stoi(argv[++i]), 1));
+        else
+        {
+            std::cerr << "usage: " << argv[0]
+                      << " [--batch corpus_file [--binary] [--threads N]]\n";
+            return 1;
+        }
+    }
+
+    std::ifstream in{corpus_file, binary ? std::ios::binary : std::ios::in};
+    if (!in)
+        throw std::runtime_error{"cannot open " + corpus_file};
+
+    const auto corpus = binary ? load_binary_corpus(in) : load_hex_corpus(in);
+    validate_batch(corpus, num_threads);
+    return 0;
+}
 }  // namespace
 
-int main()
+int main(int argc, char* argv[])
 {
     try
     {
+        if (argc > 1)
+            return main_batch(argc, argv);
+
         for (std::string line; std::getline(std::cin, line);)
         {
             if (line.empty() || line.starts_with('#'))
@@ -61,7 +214,7 @@ int main()
 
             const auto header = evmone::read_valid_eof1_header(eof);
             std::cout << "OK ";
-            for (size_t i = 0; i < header.code_sizes.size(); ++i)
+            for (size_t i = 0; i < header.num_code_sections; ++i)
             {
                 if (i != 0)
                     std::cout << ",";
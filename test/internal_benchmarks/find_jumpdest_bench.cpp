@@ -4,6 +4,7 @@
 
 #include <benchmark/benchmark.h>
 #include <array>
+#include <bit>
 #include <random>
 #include <unordered_map>
 
@@ -308,6 +309,91 @@ void find_jumpdest_hashmap_random(benchmark::State& state)
 BENCHMARK_TEMPLATE(find_jumpdest_hashmap_random, int);
 BENCHMARK_TEMPLATE(find_jumpdest_hashmap_random, uint16_t);
 
+
+/// The two-level jumpdest index: for every 64 offsets the bitmap of jumpdests
+/// and the number of jumpdests before (rank). The target is found in O(1).
+struct bitmap_index
+{
+    struct entry
+    {
+        uint64_t bitmap;
+        uint32_t rank;
+    };
+
+    std::array<entry, (2 * jumpdest_map_size) / 64 + 1> index;
+    std::array<int, jumpdest_map_size> targets;
+};
+
+const bitmap_index bitmap_map = []() noexcept {
+    auto m = bitmap_index{};
+    const auto& map = map_builder<int>::map;
+    for (size_t i = 0; i < map.size(); ++i)
+    {
+        const auto offset = static_cast<size_t>(map[i].first);
+        m.index[offset / 64].bitmap |= uint64_t{1} << (offset % 64);
+        m.targets[i] = map[i].second;
+    }
+    uint32_t rank = 0;
+    for (auto& e : m.index)
+    {
+        e.rank = rank;
+        rank += static_cast<uint32_t>(std::popcount(e.bitmap));
+    }
+    return m;
+}();
+
+inline int bitmap_lookup(const bitmap_index& m, int offset) noexcept
+{
+    const auto chunk = static_cast<size_t>(static_cast<unsigned>(offset) / 64);
+    if (chunk >= m.index.size())
+        return -1;
+    const auto& e = m.index[chunk];
+    const auto bit = uint64_t{1} << (static_cast<unsigned>(offset) % 64);
+    if ((e.bitmap & bit) == 0)
+        return -1;
+    return m.targets[e.rank + static_cast<uint32_t>(std::popcount(e.bitmap & (bit - 1)))];
+}
+
+void find_jumpdest_bitmap(benchmark::State& state)
+{
+    const auto needle = static_cast<int>(state.range(1));
+    benchmark::ClobberMemory();
+
+    int x = -1;
+    for (auto _ : state)
+    {
+        x = bitmap_lookup(bitmap_map, needle);
+        benchmark::DoNotOptimize(x);
+    }
+
+    if (needle % 2 == 1)
+    {
+        if (x != needle + 1)
+            state.SkipWithError("incorrect element found");
+    }
+    else if (x != -1)
+        state.SkipWithError("element should not have been found");
+}
+
+void find_jumpdest_bitmap_random(benchmark::State& state)
+{
+    const auto indexes = random_indexes;
+    benchmark::ClobberMemory();
+
+    while (state.KeepRunningBatch(indexes.size()))
+    {
+        for (auto i : indexes)
+        {
+            auto x = bitmap_lookup(bitmap_map, i);
+            benchmark::DoNotOptimize(x);
+        }
+    }
+}
+
+// The size argument is ignored: the lookup does not depend on the number of jumpdests.
+BENCHMARK(find_jumpdest_bitmap) ARGS;
+BENCHMARK(find_jumpdest_bitmap_random);
+
 }  // namespace
 
 BENCHMARK_MAIN();
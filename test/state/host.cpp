@@ -5,7 +5,7 @@
 #include "host.hpp"
 #include "precompiles.hpp"
 #include "rlp.hpp"
-#include <evmone/eof.hpp>
+#include <evmone/eof_validation_cache.hpp>
 
 namespace evmone::state
 {
@@ -201,7 +201,7 @@ evmc::Result Host::create(const evmc_message& msg) noexcept
 
     if (m_rev >= EVMC_CANCUN && (is_eof_container(initcode) || is_eof_container(sender_acc.code)))
     {
-        if (validate_eof(m_rev, initcode) != EOFValidationError::success)
+        if (validate_eof_cached(m_rev, initcode) != EOFValidationError::success)
             return evmc::Result{EVMC_CONTRACT_VALIDATION_FAILURE};
     }
 
@@ -230,7 +230,7 @@ evmc::Result Host::create(const evmc_message& msg) noexcept
 
     if (m_rev >= EVMC_CANCUN && (is_eof_container(initcode) || is_eof_container(code)))
     {
-        if (validate_eof(m_rev, code) != EOFValidationError::success)
+        if (validate_eof_cached(m_rev, code) != EOFValidationError::success)
             return evmc::Result{EVMC_CONTRACT_VALIDATION_FAILURE};
     }
     else if (m_rev >= EVMC_LONDON && !code.empty() && code[0] == 0xEF)  // Reject EF code.
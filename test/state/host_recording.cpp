@@ -0,0 +1,520 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "host_recording.hpp"
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <type_traits>
+
+namespace evmone::state
+{
+namespace
+{
+constexpr uint8_t magic[8] = {'E', 'V', 'M', 'H', 'R', 'E', 'C', 0};
+
+template <typename T>
+void put(bytes& out, const T& value)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.append(reinterpret_cast<const uint8_t*>(&value), sizeof(value));
+}
+
+void put(bytes& out, bytes_view data)
+{
+    put(out, static_cast<uint32_t>(data.size()));
+    out.append(data);
+}
+
+void put(bytes& out, const evmc_message& msg)
+{
+    put(out, msg.kind);
+    put(out, msg.flags);
+    put(out, msg.depth);
+    put(out, msg.gas);
+    put(out, msg.recipient);
+    put(out, msg.sender);
+    put(out, msg.value);
+    put(out, msg.create2_salt);
+    put(out, msg.code_address);
+    put(out, msg.input_size != 0 ? bytes_view{msg.input_data, msg.input_size} : bytes_view{});
+}
+
+void put(bytes& out, const evmc_tx_context& tx_context)
+{
+    put(out, tx_context.tx_gas_price);
+    put(out, tx_context.tx_origin);
+    put(out, tx_context.block_coinbase);
+    put(out, tx_context.block_number);
+    put(out, tx_context.block_timestamp);
+    put(out, tx_context.block_gas_limit);
+    put(out, tx_context.block_prev_randao);
+    put(out, tx_context.chain_id);
+    put(out, tx_context.block_base_fee);
+}
+
+/// Reads the serialized values. After the end of the data is reached all values are zero.
+class Reader
+{
+    bytes_view m_data;
+    bool m_error = false;
+
+public:
+    explicit Reader(bytes_view data) noexcept : m_data{data} {}
+
+    [[nodiscard]] bool error() const noexcept { return m_error; }
+
+    [[nodiscard]] size_t position(bytes_view data) const noexcept
+    {
+        return data.size() - m_data.size();
+    }
+
+    template <typename T>
+    T get() noexcept
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value{};
+        if (m_data.size() < sizeof(value))
+            m_error = true;
+        if (m_error)
+            return value;
+        std::memcpy(&value, m_data.data(), sizeof(value));
+        m_data.remove_prefix(sizeof(value));
+        return value;
+    }
+
+    bytes_view get_bytes(size_t size) noexcept
+    {
+        if (m_data.size() < size)
+            m_error = true;
+        if (m_error)
+            return {};
+        const auto data = m_data.substr(0, size);
+        m_data.remove_prefix(size);
+        return data;
+    }
+
+    bytes_view get_bytes() noexcept { return get_bytes(get<uint32_t>()); }
+};
+
+bytes_view topics_view(const bytes32 topics[], size_t num_topics) noexcept
+{
+    return {reinterpret_cast<const uint8_t*>(topics), num_topics * sizeof(bytes32)};
+}
+}  // namespace
+
+HostRecording::HostRecording(evmc_revision _rev, const evmc_message& _msg, bytes_view _code)
+  : rev{_rev},
+    msg{_msg},
+    input{_msg.input_size != 0 ? bytes{_msg.input_data, _msg.input_size} : bytes{}},
+    code{_code}
+{
+    msg.input_data = input.data();
+}
+
+HostRecording::HostRecording(HostRecording&& other) noexcept
+  : rev{other.rev},
+    msg{other.msg},
+    input{std::move(other.input)},
+    code{std::move(other.code)},
+    calls{std::move(other.calls)}
+{
+    msg.input_data = input.data();
+}
+
+HostRecording& HostRecording::operator=(HostRecording&& other) noexcept
+{
+    rev = other.rev;
+    msg = other.msg;
+    input = std::move(other.input);
+    code = std::move(other.code);
+    calls = std::move(other.calls);
+    msg.input_data = input.data();
+    return *this;
+}
+
+void HostRecording::save(std::ostream& out) const
+{
+    bytes data{magic, std::size(magic)};
+    put(data, format_version);
+    put(data, rev);
+    put(data, msg);
+    put(data, bytes_view{code});
+    put(data, static_cast<uint64_t>(calls.size()));
+    data += calls;
+    out.write(
+        reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+std::optional<HostRecording> HostRecording::load(std::istream& in)
+{
+    const bytes data{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    Reader r{data};
+    if (r.get_bytes(std::size(magic)) != bytes_view{magic, std::size(magic)} ||
+        r.get<uint32_t>() != format_version)
+        return {};
+
+    HostRecording recording;
+    recording.rev = r.get<evmc_revision>();
+    auto& msg = recording.msg;
+    msg.kind = r.get<evmc_call_kind>();
+    msg.flags = r.get<uint32_t>();
+    msg.depth = r.get<int32_t>();
+    msg.gas = r.get<int64_t>();
+    msg.recipient = r.get<evmc::address>();
+    msg.sender = r.get<evmc::address>();
+    msg.value = r.get<evmc::uint256be>();
+    msg.create2_salt = r.get<evmc::bytes32>();
+    msg.code_address = r.get<evmc::address>();
+    recording.input = r.get_bytes();
+    msg.input_data = recording.input.data();
+    msg.input_size = recording.input.size();
+    recording.code = r.get_bytes();
+    recording.calls = r.get_bytes(static_cast<size_t>(r.get<uint64_t>()));
+    if (r.error() || r.position(data) != data.size() || recording.rev > EVMC_MAX_REVISION)
+        return {};
+    return recording;
+}
+
+
+bool RecordingHost::account_exists(const address& addr) const noexcept
+{
+    const auto result = m_host.account_exists(addr);
+    put(m_recording.calls, HostCall::account_exists);
+    put(m_recording.calls, addr);
+    put(m_recording.calls, result);
+    return result;
+}
+
+bytes32 RecordingHost::get_storage(const address& addr, const bytes32& key) const noexcept
+{
+    const auto result = m_host.get_storage(addr, key);
+    put(m_recording.calls, HostCall::get_storage);
+    put(m_recording.calls, addr);
+    put(m_recording.calls, key);
+    put(m_recording.calls, result);
+    return result;
+}
+
+evmc_storage_status RecordingHost::set_storage(
+    const address& addr, const bytes32& key, const bytes32& value) noexcept
+{
+    const auto result = m_host.set_storage(addr, key, value);
+    put(m_recording.calls, HostCall::set_storage);
+    put(m_recording.calls, addr);
+    put(m_recording.calls, key);
+    put(m_recording.calls, value);
+    put(m_recording.calls, result);
+    return result;
+}
+
+evmc::uint256be RecordingHost::get_balance(const address& addr) const noexcept
+{
+    const auto result = m_host.get_balance(addr);
+    put(m_recording.calls, HostCall::get_balance);
+    put(m_recording.calls, addr);
+    put(m_recording.calls, result);
+    return result;
+}
+
+size_t RecordingHost::get_code_size(const address& addr) const noexcept
+{
+    const auto result = m_host.get_code_size(addr);
+    put(m_recording.calls, HostCall::get_code_size);
+    put(m_recording.calls, addr);
+    put(m_recording.calls, static_cast<uint64_t>(result));
+    return result;
+}
+
+bytes32 RecordingHost::get_code_hash(const address& addr) const noexcept
+{
+    const auto result = m_host.get_code_hash(addr);
+    put(m_recording.calls, HostCall::get_code_hash);
+    put(m_recording.calls, addr);
+    put(m_recording.calls, result);
+    return result;
+}
+
+size_t RecordingHost::copy_code(const address& addr, size_t code_offset, uint8_t* buffer_data,
+    size_t buffer_size) const noexcept
+{
+    const auto result = m_host.copy_code(addr, code_offset, buffer_data, buffer_size);
+    put(m_recording.calls, HostCall::copy_code);
+    put(m_recording.calls, addr);
+    put(m_recording.calls, static_cast<uint64_t>(code_offset));
+    put(m_recording.calls, static_cast<uint64_t>(buffer_size));
+    put(m_recording.calls, bytes_view{buffer_data, result});
+    return result;
+}
+
+bool RecordingHost::selfdestruct(const address& addr, const address& beneficiary) noexcept
+{
+    const auto result = m_host.selfdestruct(addr, beneficiary);
+    put(m_recording.calls, HostCall::selfdestruct);
+    put(m_recording.calls, addr);
+    put(m_recording.calls, beneficiary);
+    put(m_recording.calls, result);
+    return result;
+}
+
+evmc::Result RecordingHost::call(const evmc_message& msg) noexcept
+{
+    auto result = m_host.call(msg);
+    put(m_recording.calls, HostCall::call);
+    put(m_recording.calls, msg);
+    put(m_recording.calls, result.status_code);
+    put(m_recording.calls, result.gas_left);
+    put(m_recording.calls, result.gas_refund);
+    put(m_recording.calls, result.create_address);
+    put(m_recording.calls, bytes_view{result.output_data, result.output_size});
+    return result;
+}
+
+evmc_tx_context RecordingHost::get_tx_context() const noexcept
+{
+    const auto result = m_host.get_tx_context();
+    put(m_recording.calls, HostCall::get_tx_context);
+    put(m_recording.calls, result);
+    return result;
+}
+
+bytes32 RecordingHost::get_block_hash(int64_t block_number) const noexcept
+{
+    const auto result = m_host.get_block_hash(block_number);
+    put(m_recording.calls, HostCall::get_block_hash);
+    put(m_recording.calls, block_number);
+    put(m_recording.calls, result);
+    return result;
+}
+
+void RecordingHost::emit_log(const address& addr, const uint8_t* data, size_t data_size,
+    const bytes32 topics[], size_t num_topics) noexcept
+{
+    m_host.emit_log(addr, data, data_size, topics, num_topics);
+    put(m_recording.calls, HostCall::emit_log);
+    put(m_recording.calls, addr);
+    put(m_recording.calls, bytes_view{data, data_size});
+    put(m_recording.calls, topics_view(topics, num_topics));
+}
+
+evmc_access_status RecordingHost::access_account(const address& addr) noexcept
+{
+    const auto result = m_host.access_account(addr);
+    put(m_recording.calls, HostCall::access_account);
+    put(m_recording.calls, addr);
+    put(m_recording.calls, result);
+    return result;
+}
+
+evmc_access_status RecordingHost::access_storage(const address& addr, const bytes32& key) noexcept
+{
+    const auto result = m_host.access_storage(addr, key);
+    put(m_recording.calls, HostCall::access_storage);
+    put(m_recording.calls, addr);
+    put(m_recording.calls, key);
+    put(m_recording.calls, result);
+    return result;
+}
+
+
+template <typename... Args>
+bool ReplayHost::expect(HostCall kind, const Args&... args) const noexcept
+{
+    if (m_diverged)
+        return false;
+
+    m_args.clear();
+    put(m_args, kind);
+    (put(m_args, args), ...);
+
+    const auto& calls = m_recording.calls;
+    if (calls.size() - m_pos < m_args.size() || calls.compare(m_pos, m_args.size(), m_args) != 0)
+    {
+        m_diverged = true;
+        return false;
+    }
+    m_pos += m_args.size();
+    return true;
+}
+
+template <typename T>
+T ReplayHost::read() const noexcept
+{
+    if (m_diverged)
+        return T{};
+    Reader r{bytes_view{m_recording.calls}.substr(m_pos)};
+    const auto value = r.get<T>();
+    m_diverged = r.error();
+    if (!m_diverged)
+        m_pos += sizeof(T);
+    return value;
+}
+
+bytes_view ReplayHost::read_bytes() const noexcept
+{
+    const auto size = read<uint32_t>();
+    if (m_diverged)
+        return {};
+    Reader r{bytes_view{m_recording.calls}.substr(m_pos)};
+    const auto data = r.get_bytes(size);
+    m_diverged = r.error();
+    if (!m_diverged)
+        m_pos += size;
+    return data;
+}
+
+bool ReplayHost::account_exists(const address& addr) const noexcept
+{
+    return expect(HostCall::account_exists, addr) && read<bool>();
+}
+
+bytes32 ReplayHost::get_storage(const address& addr, const bytes32& key) const noexcept
+{
+    if (!expect(HostCall::get_storage, addr, key))
+        return {};
+    return read<bytes32>();
+}
+
+evmc_storage_status ReplayHost::set_storage(
+    const address& addr, const bytes32& key, const bytes32& value) noexcept
+{
+    if (!expect(HostCall::set_storage, addr, key, value))
+        return EVMC_STORAGE_ASSIGNED;
+    return read<evmc_storage_status>();
+}
+
+evmc::uint256be ReplayHost::get_balance(const address& addr) const noexcept
+{
+    if (!expect(HostCall::get_balance, addr))
+        return {};
+    return read<evmc::uint256be>();
+}
+
+size_t ReplayHost::get_code_size(const address& addr) const noexcept
+{
+    if (!expect(HostCall::get_code_size, addr))
+        return 0;
+    return static_cast<size_t>(read<uint64_t>());
+}
+
+bytes32 ReplayHost::get_code_hash(const address& addr) const noexcept
+{
+    if (!expect(HostCall::get_code_hash, addr))
+        return {};
+    return read<bytes32>();
+}
+
+size_t ReplayHost::copy_code(const address& addr, size_t code_offset, uint8_t* buffer_data,
+    size_t buffer_size) const noexcept
+{
+    if (!expect(HostCall::copy_code, addr, static_cast<uint64_t>(code_offset),
+            static_cast<uint64_t>(buffer_size)))
+        return 0;
+    const auto data = read_bytes();
+    if (data.size() > buffer_size)
+    {
+        m_diverged = true;
+        return 0;
+    }
+    if (!data.empty())
+        std::memcpy(buffer_data, data.data(), data.size());
+    return data.size();
+}
+
+bool ReplayHost::selfdestruct(const address& addr, const address& beneficiary) noexcept
+{
+    return expect(HostCall::selfdestruct, addr, beneficiary) && read<bool>();
+}
+
+evmc::Result ReplayHost::call(const evmc_message& msg) noexcept
+{
+    if (!expect(HostCall::call, msg))
+        return evmc::Result{EVMC_INTERNAL_ERROR};
+
+    const auto status_code = read<evmc_status_code>();
+    const auto gas_left = read<int64_t>();
+    const auto gas_refund = read<int64_t>();
+    const auto create_address = read<evmc::address>();
+    const auto output = read_bytes();
+    evmc::Result result{status_code, gas_left, gas_refund, output.data(), output.size()};
+    result.create_address = create_address;
+    return result;
+}
+
+evmc_tx_context ReplayHost::get_tx_context() const noexcept
+{
+    evmc_tx_context tx_context{};
+    if (!expect(HostCall::get_tx_context))
+        return tx_context;
+    tx_context.tx_gas_price = read<evmc::uint256be>();
+    tx_context.tx_origin = read<evmc::address>();
+    tx_context.block_coinbase = read<evmc::address>();
+    tx_context.block_number = read<int64_t>();
+    tx_context.block_timestamp = read<int64_t>();
+    tx_context.block_gas_limit = read<int64_t>();
+    tx_context.block_prev_randao = read<evmc::uint256be>();
+    tx_context.chain_id = read<evmc::uint256be>();
+    tx_context.block_base_fee = read<evmc::uint256be>();
+    return tx_context;
+}
+
+bytes32 ReplayHost::get_block_hash(int64_t block_number) const noexcept
+{
+    if (!expect(HostCall::get_block_hash, block_number))
+        return {};
+    return read<bytes32>();
+}
+
+void ReplayHost::emit_log(const address& addr, const uint8_t* data, size_t data_size,
+    const bytes32 topics[], size_t num_topics) noexcept
+{
+    (void)expect(HostCall::emit_log, addr, bytes_view{data, data_size},
+        topics_view(topics, num_topics));
+}
+
+evmc_access_status ReplayHost::access_account(const address& addr) noexcept
+{
+    if (!expect(HostCall::access_account, addr))
+        return EVMC_ACCESS_COLD;
+    return read<evmc_access_status>();
+}
+
+evmc_access_status ReplayHost::access_storage(const address& addr, const bytes32& key) noexcept
+{
+    if (!expect(HostCall::access_storage, addr, key))
+        return EVMC_ACCESS_COLD;
+    return read<evmc_access_status>();
+}
+
+
+RecordingVM::RecordingVM(evmc::VM& vm) noexcept
+  : evmc_vm{EVMC_ABI_VERSION, "recording", "", [](evmc_vm* /*vm*/) noexcept {}, execute_fn,
+        [](evmc_vm* self) noexcept {
+            auto& inner = static_cast<RecordingVM*>(self)->m_vm;
+            return inner.get_capabilities(&inner);
+        },
+        [](evmc_vm* self, const char* option_name, const char* option_value) noexcept {
+            auto& inner = static_cast<RecordingVM*>(self)->m_vm;
+            return inner.set_option(&inner, option_name, option_value);
+        }},
+    m_vm{*vm.get_raw_pointer()}
+{}
+
+evmc_result RecordingVM::execute_fn(evmc_vm* vm, const evmc_host_interface* host,
+    evmc_host_context* context, evmc_revision rev, const evmc_message* msg, const uint8_t* code,
+    size_t code_size) noexcept
+{
+    auto& self = *static_cast<RecordingVM*>(vm);
+    auto& inner = self.m_vm;
+    if (msg->depth != 0)
+        return inner.execute(&inner, host, context, rev, msg, code, code_size);
+
+    auto& recording = self.m_recordings.emplace_back(rev, *msg, bytes_view{code, code_size});
+    evmc::HostContext host_context{*host, context};
+    RecordingHost recording_host{host_context, recording};
+    return inner.execute(&inner, &evmc::Host::get_interface(), recording_host.to_context(), rev,
+        msg, code, code_size);
+}
+}  // namespace evmone::state
@@ -0,0 +1,190 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include "hash_utils.hpp"
+#include <evmc/evmc.hpp>
+#include <evmone/execution_stats.hpp>
+#include <iosfwd>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace evmone::state
+{
+/// The recorded host interaction of a single top-level execution.
+///
+/// Contains the execution inputs (revision, message, code) and the log of all host calls
+/// with their arguments and results in the order of execution. The nested calls are recorded
+/// with their results only, i.e. the replay executes only the top-level code.
+///
+/// The file format is the magic "EVMHREC", the format version and the serialized fields.
+/// The numbers are stored in the native byte order of the recording machine.
+struct HostRecording
+{
+    static constexpr uint32_t format_version = 1;
+
+    evmc_revision rev = EVMC_MAX_REVISION;
+    evmc_message msg{};  ///< The message. The input_data points to the input.
+    bytes input;
+    bytes code;
+    bytes calls;  ///< The serialized host calls.
+
+    HostRecording() = default;
+    HostRecording(evmc_revision rev, const evmc_message& msg, bytes_view code);
+
+    HostRecording(const HostRecording&) = delete;
+    HostRecording& operator=(const HostRecording&) = delete;
+
+    /// Writes the recording to the output stream.
+    void save(std::ostream& out) const;
+
+    /// Reads the recording from the input stream. Returns empty optional on format errors.
+    [[nodiscard]] static std::optional<HostRecording> load(std::istream& in);
+
+    // The default move would leave msg.input_data pointing to the moved-from input.
+    HostRecording(HostRecording&& other) noexcept;
+    HostRecording& operator=(HostRecording&& other) noexcept;
+};
+
+/// The host proxy forwarding the calls to the host and recording them in the HostRecording.
+class RecordingHost : public evmc::Host
+{
+    evmc::HostInterface& m_host;
+    HostRecording& m_recording;
+
+public:
+    RecordingHost(evmc::HostInterface& host, HostRecording& recording) noexcept
+      : m_host{host}, m_recording{recording}
+    {}
+
+    [[nodiscard]] bool account_exists(const address& addr) const noexcept override;
+
+    [[nodiscard]] bytes32 get_storage(
+        const address& addr, const bytes32& key) const noexcept override;
+
+    evmc_storage_status set_storage(
+        const address& addr, const bytes32& key, const bytes32& value) noexcept override;
+
+    [[nodiscard]] evmc::uint256be get_balance(const address& addr) const noexcept override;
+
+    [[nodiscard]] size_t get_code_size(const address& addr) const noexcept override;
+
+    [[nodiscard]] bytes32 get_code_hash(const address& addr) const noexcept override;
+
+    size_t copy_code(const address& addr, size_t code_offset, uint8_t* buffer_data,
+        size_t buffer_size) const noexcept override;
+
+    bool selfdestruct(const address& addr, const address& beneficiary) noexcept override;
+
+    evmc::Result call(const evmc_message& msg) noexcept override;
+
+    [[nodiscard]] evmc_tx_context get_tx_context() const noexcept override;
+
+    [[nodiscard]] bytes32 get_block_hash(int64_t block_number) const noexcept override;
+
+    void emit_log(const address& addr, const uint8_t* data, size_t data_size,
+        const bytes32 topics[], size_t num_topics) noexcept override;
+
+    evmc_access_status access_account(const address& addr) noexcept override;
+
+    evmc_access_status access_storage(const address& addr, const bytes32& key) noexcept override;
+};
+
+/// The host serving the recorded answers to the host calls without any state backend.
+///
+/// The host calls must match the recorded ones (the execution must not diverge from
+/// the recording). After the first mismatch the host only returns default values
+/// and diverged() is true.
+class ReplayHost : public evmc::Host
+{
+    const HostRecording& m_recording;
+    mutable size_t m_pos = 0;
+    mutable bool m_diverged = false;
+    mutable bytes m_args;
+
+public:
+    explicit ReplayHost(const HostRecording& recording) noexcept : m_recording{recording} {}
+
+    /// Restarts the replay from the first recorded host call.
+    void rewind() noexcept
+    {
+        m_pos = 0;
+        m_diverged = false;
+    }
+
+    /// Returns true if the execution has diverged from the recording
+    /// or has not made all the recorded host calls.
+    [[nodiscard]] bool diverged() const noexcept
+    {
+        return m_diverged || m_pos != m_recording.calls.size();
+    }
+
+    [[nodiscard]] bool account_exists(const address& addr) const noexcept override;
+
+    [[nodiscard]] bytes32 get_storage(
+        const address& addr, const bytes32& key) const noexcept override;
+
+    evmc_storage_status set_storage(
+        const address& addr, const bytes32& key, const bytes32& value) noexcept override;
+
+    [[nodiscard]] evmc::uint256be get_balance(const address& addr) const noexcept override;
+
+    [[nodiscard]] size_t get_code_size(const address& addr) const noexcept override;
+
+    [[nodiscard]] bytes32 get_code_hash(const address& addr) const noexcept override;
+
+    size_t copy_code(const address& addr, size_t code_offset, uint8_t* buffer_data,
+        size_t buffer_size) const noexcept override;
+
+    bool selfdestruct(const address& addr, const address& beneficiary) noexcept override;
+
+    evmc::Result call(const evmc_message& msg) noexcept override;
+
+    [[nodiscard]] evmc_tx_context get_tx_context() const noexcept override;
+
+    [[nodiscard]] bytes32 get_block_hash(int64_t block_number) const noexcept override;
+
+    void emit_log(const address& addr, const uint8_t* data, size_t data_size,
+        const bytes32 topics[], size_t num_topics) noexcept override;
+
+    evmc_access_status access_account(const address& addr) noexcept override;
+
+    evmc_access_status access_storage(const address& addr, const bytes32& key) noexcept override;
+
+private:
+    /// Checks if the next recorded host call matches the given one and moves past its arguments.
+    template <typename... Args>
+    bool expect(HostCall kind, const Args&... args) const noexcept;
+
+    /// Reads the result value of the current host call.
+    template <typename T>
+    T read() const noexcept;
+
+    /// Reads the size-prefixed result bytes of the current host call.
+    bytes_view read_bytes() const noexcept;
+};
+
+/// The EVMC VM proxy recording the host interaction of every top-level execution.
+class RecordingVM : public evmc_vm
+{
+    evmc_vm& m_vm;
+    std::vector<HostRecording> m_recordings;
+
+public:
+    /// Creates the proxy of the VM. The VM must outlive the proxy.
+    explicit RecordingVM(evmc::VM& vm) noexcept;
+
+    /// Returns the recordings collected so far and clears them.
+    [[nodiscard]] std::vector<HostRecording> take_recordings() noexcept
+    {
+        return std::exchange(m_recordings, {});
+    }
+
+private:
+    static evmc_result execute_fn(evmc_vm* vm, const evmc_host_interface* host,
+        evmc_host_context* context, evmc_revision rev, const evmc_message* msg,
+        const uint8_t* code, size_t code_size) noexcept;
+};
+}  // namespace evmone::state
@@ -4,7 +4,7 @@
 
 #include "../utils/stdx/utility.hpp"
 #include "statetest.hpp"
-#include <evmone/eof.hpp>
+#include <evmone/eof_validation_cache.hpp>
 #include <nlohmann/json.hpp>
 
 namespace evmone::test
@@ -380,7 +380,7 @@ void validate_deployed_code(const state::State& state, evmc_revision rev)
         {
             if (rev >= EVMC_CANCUN)
             {
-                if (const auto result = validate_eof(rev, acc.code);
+                if (const auto result = validate_eof_cached(rev, acc.code);
                     result != EOFValidationError::success)
                 {
                     throw std::invalid_argument(
@@ -2,6 +2,7 @@
 // Copyright 2023 The evmone Authors.
 // SPDX-License-Identifier: Apache-2.0
 
+#include "../state/host_recording.hpp"
 #include "../state/mpt_hash.hpp"
 #include "../state/rlp.hpp"
 #include "../statetest/statetest.hpp"
@@ -29,6 +30,7 @@ int main(int argc, const char* argv[])
     fs::path output_result_file;
     fs::path output_alloc_file;
     fs::path output_body_file;
+    std::string output_hostrec_prefix;
     std::optional<uint64_t> block_reward;
     uint64_t chain_id = 0;
 
@@ -63,6 +65,8 @@ int main(int argc, const char* argv[])
                 chain_id = intx::from_string<uint64_t>(argv[i]);
             else if (arg == "--output.body" && ++i < argc)
                 output_body_file = argv[i];
+            else if (arg == "--output.hostrec" && ++i < argc)
+                output_hostrec_prefix = argv[i];
         }
 
         state::BlockInfo block;
@@ -95,6 +99,12 @@ int main(int argc, const char* argv[])
 
             evmc::VM vm{evmc_create_evmone(), {{"O", "0"}}};
 
+            // Optionally record the host interaction of the transactions' executions
+            // to the <prefix>.<tx index>.hostrec files for the offline replay in evmone-bench.
+            state::RecordingVM recording_vm{vm};
+            evmc::VM recorded_vm{&recording_vm};  // Does not destroy the recorded VM.
+            auto& tx_vm = output_hostrec_prefix.empty() ? vm : recorded_vm;
+
             std::vector<state::Log> txs_logs;
 
             if (j_txs.is_array())
@@ -107,7 +117,16 @@ int main(int argc, const char* argv[])
                     auto tx = test::from_json<state::Transaction>(j_txs[i]);
                     tx.chain_id = chain_id;
 
-                    auto res = state::transition(state, block, tx, rev, vm);
+                    auto res = state::transition(state, block, tx, rev, tx_vm);
+
+                    for (const auto& recording : recording_vm.take_recordings())
+                    {
+                        std::ofstream out{
+                            output_dir / (output_hostrec_prefix + '.' + std::to_string(i) +
+                                             ".hostrec"),
+                            std::ios::binary};
+                        recording.save(out);
+                    }
 
                     const auto computed_tx_hash = keccak256(rlp::encode(tx));
 
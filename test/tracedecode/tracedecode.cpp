@@ -0,0 +1,144 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+/// @file
+/// Converts the binary execution trace to the JSON format of the instruction tracer.
+///
+/// Usage: evmone-tracedecode trace_file
+
+#include <evmc/evmc.hpp>
+#include <evmc/hex.hpp>
+#include <evmone/binary_trace.hpp>
+#include <evmone/instructions_traits.hpp>
+#include <intx/intx.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stack>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+using namespace evmone::binary_trace;
+
+std::string get_name(uint8_t opcode)
+{
+    const auto name = evmone::instr::traits[opcode].name;
+    return (name != nullptr) ? name : "0x" + evmc::hex(opcode);
+}
+
+bool read_record(std::istream& in, Record& r)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&r), sizeof(r)));
+}
+
+void decode(std::istream& in, std::ostream& out)
+{
+    FileHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        !std::equal(std::begin(header.magic), std::end(header.magic),
+            std::begin(FileHeader::expected_magic)))
+        throw std::runtime_error{"not a binary trace"};
+    if (header.version != FileHeader::expected_version || header.record_size != sizeof(Record))
+        throw std::runtime_error{"unsupported binary trace version"};
+
+    std::stack<int64_t> start_gas;  // The gas limits of the nested executions.
+    Record r{};
+    while (read_record(in, r))
+    {
+        switch (r.kind)
+        {
+        case RecordKind::execution_start:
+            start_gas.push(r.gas);
+            out << "{";
+            out << R"("depth":)" << std::dec << r.value;
+            out << R"(,"rev":")" << static_cast<evmc_revision>(r.pc) << '"';
+            out << R"(,"static":)" << (r.is_static != 0 ? "true" : "false");
+            out << "}\n";
+            break;
+
+        case RecordKind::instruction:
+        {
+            out << "{";
+            out << R"("pc":)" << std::dec << r.pc;
+            out << R"(,"op":)" << std::dec << int{r.opcode};
+            out << R"(,"opName":")" << get_name(r.opcode) << '"';
+            out << R"(,"gas":0x)" << std::hex << r.gas;
+            out << R"(,"stack":[)";
+            // The items are stored from the top, output them from the bottom.
+            for (auto i = size_t{r.data_size}; i != 0; --i)
+            {
+                intx::uint256 item;
+                std::memcpy(&item, r.data[i - 1], sizeof(item));
+                if (i != r.data_size)
+                    out << ',';
+                out << R"("0x)" << to_string(item, 16) << '"';
+            }
+            out << ']';
+            out << R"(,"memorySize":)" << std::dec << r.size;
+            out << "}\n";
+            break;
+        }
+
+        case RecordKind::execution_end:
+        {
+            if (start_gas.empty())
+                throw std::runtime_error{"unexpected execution end"};
+
+            evmc::bytes output;
+            while (output.size() < r.size)
+            {
+                Record o{};
+                if (!read_record(in, o) || o.kind != RecordKind::output)
+                    throw std::runtime_error{"missing output"};
+                output.append(reinterpret_cast<const uint8_t*>(o.data), o.data_size);
+            }
+
+            const auto status_code = static_cast<evmc_status_code>(r.value);
+            out << "{";
+            out << R"("error":)";
+            if (status_code == EVMC_SUCCESS)
+                out << "null";
+            else
+                out << '"' << status_code << '"';
+            out << R"(,"gas":)" << std::hex << "0x" << r.gas;
+            out << R"(,"gasUsed":)" << std::hex << "0x" << (start_gas.top() - r.gas);
+            out << R"(,"output":")" << evmc::hex(output) << '"';
+            out << "}\n";
+            start_gas.pop();
+            break;
+        }
+
+        default:
+            throw std::runtime_error{"invalid record"};
+        }
+    }
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 2)
+        {
+            std::cerr << "usage: " << argv[0] << " trace_file\n";
+            return 1;
+        }
+
+        std::ifstream in{argv[1], std::ios::binary};
+        if (!in)
+            throw std::runtime_error{std::string{"cannot open "} + argv[1]};
+
+        decode(in, std::cout);
+        return 0;
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << ex.what() << "\n";
+        return 1;
+    }
+}
@@ -11,7 +11,6 @@
 using namespace evmone::advanced;
 
 constexpr auto rev = EVMC_BYZANTIUM;
-const auto& op_tbl = get_op_table(rev);
 
 TEST(analysis, example1)
 {
@@ -20,16 +19,16 @@ TEST(analysis, example1)
 
     ASSERT_EQ(analysis.instrs.size(), 8);
 
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].fn, op_tbl[OP_PUSH1].fn);
-    EXPECT_EQ(analysis.instrs[2].fn, op_tbl[OP_PUSH1].fn);
-    EXPECT_EQ(analysis.instrs[3].fn, op_tbl[OP_MSTORE8].fn);
-    EXPECT_EQ(analysis.instrs[4].fn, op_tbl[OP_MSIZE].fn);
-    EXPECT_EQ(analysis.instrs[5].fn, op_tbl[OP_PUSH1].fn);
-    EXPECT_EQ(analysis.instrs[6].fn, op_tbl[OP_SSTORE].fn);
-    EXPECT_EQ(analysis.instrs[7].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_MSTORE8);
+    EXPECT_EQ(analysis.instrs[4].opcode(), OP_MSIZE);
+    EXPECT_EQ(analysis.instrs[5].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[6].opcode(), OP_SSTORE);
+    EXPECT_EQ(analysis.instrs[7].opcode(), OP_STOP);
 
-    const auto& block = analysis.instrs[0].arg.block;
+    const auto& block = analysis.blocks[analysis.instrs[0].arg()];
     EXPECT_EQ(block.gas_cost, 14u);
     EXPECT_EQ(block.stack_req, 0);
     EXPECT_EQ(block.stack_max_growth, 2);
@@ -40,14 +39,16 @@ TEST(analysis, stack_up_and_down)
     const auto code = OP_DUP2 + 6 * OP_DUP1 + 10 * OP_POP + push(0);
     const auto analysis = analyze(rev, code);
 
-    ASSERT_EQ(analysis.instrs.size(), 20);
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].fn, op_tbl[OP_DUP2].fn);
-    EXPECT_EQ(analysis.instrs[2].fn, op_tbl[OP_DUP1].fn);
-    EXPECT_EQ(analysis.instrs[8].fn, op_tbl[OP_POP].fn);
-    EXPECT_EQ(analysis.instrs[18].fn, op_tbl[OP_PUSH1].fn);
+    // All DUPs are removed together with the matching POPs.
+    ASSERT_EQ(analysis.instrs.size(), 6);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_POP);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_POP);
+    EXPECT_EQ(analysis.instrs[4].opcode(), OP_PUSH1);
 
-    const auto& block = analysis.instrs[0].arg.block;
+    // The block requirements are computed from the original instructions.
+
+    const auto& block = analysis.blocks[analysis.instrs[0].arg()];
     EXPECT_EQ(block.gas_cost, uint32_t{7 * 3 + 10 * 2 + 3});
     EXPECT_EQ(block.stack_req, 3);
     EXPECT_EQ(block.stack_max_growth, 7);
@@ -56,15 +57,53 @@ TEST(analysis, stack_up_and_down)
 TEST(analysis, push)
 {
     constexpr auto push_value = 0x8807060504030201;
-    const auto code = push(push_value) + "7f00ee";
+    const auto code = push(0x123456) + push(push_value) + "7f00ee";
     const auto analysis = analyze(rev, code);
 
-    ASSERT_EQ(analysis.instrs.size(), 4);
-    ASSERT_EQ(analysis.push_values.size(), 1);
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].arg.small_push_value, push_value);
-    EXPECT_EQ(analysis.instrs[2].arg.push_value, analysis.push_values.data());
-    EXPECT_EQ(analysis.push_values[0], intx::uint256{0xee} << 240);
+    ASSERT_EQ(analysis.instrs.size(), 5);
+    ASSERT_EQ(analysis.push_values.size(), 2);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_PUSH3);
+    EXPECT_EQ(analysis.instrs[1].arg(), 0x123456);  // Inline value.
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_PUSH8);
+    EXPECT_EQ(analysis.instrs[2].arg(), 0);
+    EXPECT_EQ(analysis.push_values[0], push_value);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_PUSH32);
+    EXPECT_EQ(analysis.instrs[3].arg(), 1);
+    EXPECT_EQ(analysis.push_values[1], intx::uint256{0xee} << 240);
+}
+
+TEST(analysis, push_truncated)
+{
+    const auto code = bytecode{"6201"};  // PUSH3 with only 1 byte of data at the code end.
+    const auto analysis = analyze(rev, code);
+
+    ASSERT_EQ(analysis.instrs.size(), 3);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_PUSH3);
+    EXPECT_EQ(analysis.instrs[1].arg(), 0x010000);
+    EXPECT_TRUE(analysis.push_values.empty());
+}
+
+TEST(analysis, exact_buffer_sizes)
+{
+    const auto code = push(0) + OP_GAS + push("00112233445566778899") + OP_JUMPI + OP_JUMPDEST +
+                      OP_PC + OP_SSTORE + push("aabbccddeeff") + OP_SLOAD + OP_STOP +
+                      OP_PUSH32 + OP_JUMPDEST;
+    const auto analysis = analyze(rev, code);
+
+    EXPECT_EQ(analysis.instrs.capacity(), analysis.instrs.size());
+    EXPECT_EQ(analysis.blocks.size(), 4);
+    EXPECT_EQ(analysis.push_values.capacity(), 2);  // The PUSH32 in dead code is skipped.
+    EXPECT_EQ(analysis.push_values.size(), 2);
+    EXPECT_EQ(analysis.partial_block_costs.capacity(), 2);
+    EXPECT_EQ(analysis.partial_block_costs.size(), 2);
+    EXPECT_EQ(analysis.jumpdest_offsets.capacity(), 2);
+    EXPECT_EQ(analysis.jumpdest_offsets.size(), 2);
+
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_GAS);
+    EXPECT_EQ(analysis.partial_block_costs[analysis.instrs[2].arg()], 3 + 2);
+    EXPECT_EQ(analysis.instrs[7].opcode(), OP_SSTORE);
+    EXPECT_EQ(analysis.partial_block_costs[analysis.instrs[7].arg()], 1 + 2);
 }
 
 TEST(analysis, jumpdest_skip)
@@ -76,10 +115,10 @@ TEST(analysis, jumpdest_skip)
     auto analysis = analyze(rev, code);
 
     ASSERT_EQ(analysis.instrs.size(), 4);
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].fn, op_tbl[OP_STOP].fn);
-    EXPECT_EQ(analysis.instrs[2].fn, op_tbl[OP_JUMPDEST].fn);
-    EXPECT_EQ(analysis.instrs[3].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_STOP);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_STOP);
 }
 
 TEST(analysis, jump1)
@@ -90,8 +129,8 @@ TEST(analysis, jump1)
     ASSERT_EQ(analysis.jumpdest_offsets.size(), 1);
     ASSERT_EQ(analysis.jumpdest_targets.size(), 1);
     EXPECT_EQ(analysis.jumpdest_offsets[0], 6);
-    EXPECT_EQ(analysis.jumpdest_targets[0], 5);
-    EXPECT_EQ(find_jumpdest(analysis, 6), 5);
+    EXPECT_EQ(analysis.jumpdest_targets[0], 2);
+    EXPECT_EQ(find_jumpdest(analysis, 6), 2);
     EXPECT_EQ(find_jumpdest(analysis, 0), -1);
     EXPECT_EQ(find_jumpdest(analysis, 7), -1);
 }
@@ -101,8 +140,8 @@ TEST(analysis, empty)
     const auto analysis = analyze(rev, {});
 
     ASSERT_EQ(analysis.instrs.size(), 2);
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_STOP);
 }
 
 TEST(analysis, only_jumpdest)
@@ -122,9 +161,9 @@ TEST(analysis, jumpi_at_the_end)
     const auto analysis = analyze(rev, code);
 
     ASSERT_EQ(analysis.instrs.size(), 3);
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].fn, op_tbl[OP_JUMPI].fn);
-    EXPECT_EQ(analysis.instrs[2].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_JUMPI);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_STOP);
 }
 
 TEST(analysis, terminated_last_block)
@@ -135,28 +174,28 @@ TEST(analysis, terminated_last_block)
     const auto analysis = analyze(rev, code);
 
     ASSERT_EQ(analysis.instrs.size(), 5);
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[3].fn, op_tbl[OP_RETURN].fn);
-    EXPECT_EQ(analysis.instrs[4].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_RETURN);
+    EXPECT_EQ(analysis.instrs[4].opcode(), OP_STOP);
 }
 
 TEST(analysis, jump_dead_code)
 {
-    constexpr auto jumpdest_offset = 6;
+    constexpr auto jumpdest_offset = 5;
     constexpr auto jumpdest_index = 3;
 
-    const auto code = push(jumpdest_offset) + OP_JUMP + 3 * OP_ADD + OP_JUMPDEST;
+    const auto code = OP_CALLDATASIZE + OP_JUMP + 3 * OP_ADD + OP_JUMPDEST;
     const auto analysis = analyze(rev, code);
 
     ASSERT_EQ(analysis.instrs.size(), 5);
-    EXPECT_EQ(analysis.instrs[0].arg.block.gas_cost, 3 + 8);
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].fn, op_tbl[OP_PUSH1].fn);
-    EXPECT_EQ(analysis.instrs[2].fn, op_tbl[OP_JUMP].fn);
+    EXPECT_EQ(analysis.blocks[analysis.instrs[0].arg()].gas_cost, 2 + 8);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_CALLDATASIZE);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_JUMP);
 
-    EXPECT_EQ(analysis.instrs[jumpdest_index].arg.block.gas_cost, 1);
-    EXPECT_EQ(analysis.instrs[jumpdest_index].fn, op_tbl[OP_JUMPDEST].fn);
-    EXPECT_EQ(analysis.instrs[4].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.blocks[analysis.instrs[jumpdest_index].arg()].gas_cost, 1);
+    EXPECT_EQ(analysis.instrs[jumpdest_index].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[4].opcode(), OP_STOP);
 
     ASSERT_EQ(analysis.jumpdest_offsets.size(), 1);
     ASSERT_EQ(analysis.jumpdest_targets.size(), 1);
@@ -174,13 +213,13 @@ TEST(analysis, stop_dead_code)
     auto analysis = analyze(rev, code);
 
     ASSERT_EQ(analysis.instrs.size(), 4);
-    EXPECT_EQ(analysis.instrs[0].arg.block.gas_cost, 0);
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.blocks[analysis.instrs[0].arg()].gas_cost, 0);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_STOP);
 
-    EXPECT_EQ(analysis.instrs[jumpdest_index].arg.block.gas_cost, 1);
-    EXPECT_EQ(analysis.instrs[jumpdest_index].fn, op_tbl[OP_JUMPDEST].fn);
-    EXPECT_EQ(analysis.instrs[3].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.blocks[analysis.instrs[jumpdest_index].arg()].gas_cost, 1);
+    EXPECT_EQ(analysis.instrs[jumpdest_index].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_STOP);
 
     ASSERT_EQ(analysis.jumpdest_offsets.size(), 1);
     ASSERT_EQ(analysis.jumpdest_targets.size(), 1);
@@ -194,10 +233,10 @@ TEST(analysis, dead_code_at_the_end)
     auto analysis = analyze(rev, code);
     ASSERT_EQ(analysis.instrs.size(), 3);
 
-    EXPECT_EQ(analysis.instrs[0].arg.block.gas_cost, 0);
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].fn, op_tbl[OP_STOP].fn);
-    EXPECT_EQ(analysis.instrs[2].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.blocks[analysis.instrs[0].arg()].gas_cost, 0);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_STOP);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_STOP);
 
     EXPECT_EQ(analysis.jumpdest_offsets.size(), 0);
     EXPECT_EQ(analysis.jumpdest_targets.size(), 0);
@@ -209,15 +248,16 @@ TEST(analysis, jumpi_jumpdest)
     auto analysis = analyze(rev, code);
 
     ASSERT_EQ(analysis.instrs.size(), 5);
-    EXPECT_EQ(analysis.instrs[0].arg.block.gas_cost, 3 + 10);
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].fn, op_tbl[OP_PUSH1].fn);
-    EXPECT_EQ(analysis.instrs[2].fn, op_tbl[OP_JUMPI].fn);
-    EXPECT_EQ(analysis.instrs[2].arg.block.gas_cost, 0);  // The block following JUMPI is empty.
-
-    EXPECT_EQ(analysis.instrs[3].arg.block.gas_cost, 1);
-    EXPECT_EQ(analysis.instrs[3].fn, op_tbl[OP_JUMPDEST].fn);
-    EXPECT_EQ(analysis.instrs[4].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.blocks[analysis.instrs[0].arg()].gas_cost, 3 + 10);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_JUMPI);
+    // The block following JUMPI is empty.
+    EXPECT_EQ(analysis.blocks[analysis.instrs[2].arg()].gas_cost, 0);
+
+    EXPECT_EQ(analysis.blocks[analysis.instrs[3].arg()].gas_cost, 1);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[4].opcode(), OP_STOP);
 }
 
 TEST(analysis, jumpdests_groups)
@@ -226,17 +266,17 @@ TEST(analysis, jumpdests_groups)
     auto analysis = analyze(rev, code);
 
     ASSERT_EQ(analysis.instrs.size(), 11);
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].fn, op_tbl[OP_JUMPDEST].fn);
-    EXPECT_EQ(analysis.instrs[2].fn, op_tbl[OP_JUMPDEST].fn);
-    EXPECT_EQ(analysis.instrs[3].fn, op_tbl[OP_JUMPDEST].fn);
-    EXPECT_EQ(analysis.instrs[4].fn, op_tbl[OP_PUSH1].fn);
-    EXPECT_EQ(analysis.instrs[5].fn, op_tbl[OP_JUMPDEST].fn);
-    EXPECT_EQ(analysis.instrs[6].fn, op_tbl[OP_JUMPDEST].fn);
-    EXPECT_EQ(analysis.instrs[7].fn, op_tbl[OP_JUMPDEST].fn);
-    EXPECT_EQ(analysis.instrs[8].fn, op_tbl[OP_PUSH1].fn);
-    EXPECT_EQ(analysis.instrs[9].fn, op_tbl[OP_JUMPI].fn);
-    EXPECT_EQ(analysis.instrs[10].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[4].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[5].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[6].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[7].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[8].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[9].opcode(), OP_JUMPI);
+    EXPECT_EQ(analysis.instrs[10].opcode(), OP_STOP);
 
 
     ASSERT_EQ(analysis.jumpdest_offsets.size(), 6);
@@ -264,17 +304,313 @@ TEST(analysis, example1_eof1)
 
     ASSERT_EQ(analysis.instrs.size(), 8);
 
-    EXPECT_EQ(analysis.instrs[0].fn, op_tbl[OPX_BEGINBLOCK].fn);
-    EXPECT_EQ(analysis.instrs[1].fn, op_tbl[OP_PUSH1].fn);
-    EXPECT_EQ(analysis.instrs[2].fn, op_tbl[OP_PUSH1].fn);
-    EXPECT_EQ(analysis.instrs[3].fn, op_tbl[OP_MSTORE8].fn);
-    EXPECT_EQ(analysis.instrs[4].fn, op_tbl[OP_MSIZE].fn);
-    EXPECT_EQ(analysis.instrs[5].fn, op_tbl[OP_PUSH1].fn);
-    EXPECT_EQ(analysis.instrs[6].fn, op_tbl[OP_SSTORE].fn);
-    EXPECT_EQ(analysis.instrs[7].fn, op_tbl[OP_STOP].fn);
+    EXPECT_EQ(analysis.instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_MSTORE8);
+    EXPECT_EQ(analysis.instrs[4].opcode(), OP_MSIZE);
+    EXPECT_EQ(analysis.instrs[5].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[6].opcode(), OP_SSTORE);
+    EXPECT_EQ(analysis.instrs[7].opcode(), OP_STOP);
 
-    const auto& block = analysis.instrs[0].arg.block;
+    const auto& block = analysis.blocks[analysis.instrs[0].arg()];
     EXPECT_EQ(block.gas_cost, 14u);
     EXPECT_EQ(block.stack_req, 0);
     EXPECT_EQ(block.stack_max_growth, 2);
 }
+
+TEST(analysis, serialize_roundtrip)
+{
+    const auto code = push(0x2a) + push("00112233445566778899aabbccddeeff") + OP_JUMPDEST + OP_GAS +
+                      OP_PC + push(4) + OP_JUMPI + OP_JUMPDEST + push(OP_PUSH20, "ee") + OP_SSTORE;
+    const auto analysis = analyze(rev, code);
+    ASSERT_EQ(analysis.push_values.size(), 2);
+    ASSERT_EQ(analysis.jumpdest_offsets.size(), 2);
+
+    const auto image = serialize(analysis, rev);
+    const auto loaded = deserialize(image, rev);
+    ASSERT_TRUE(loaded.has_value());
+
+    EXPECT_EQ(loaded->instrs, analysis.instrs);
+    EXPECT_EQ(loaded->blocks, analysis.blocks);
+    EXPECT_EQ(loaded->partial_block_costs, analysis.partial_block_costs);
+    EXPECT_EQ(loaded->push_values, analysis.push_values);
+    EXPECT_EQ(loaded->jumpdest_offsets, analysis.jumpdest_offsets);
+    EXPECT_EQ(loaded->jumpdest_targets, analysis.jumpdest_targets);
+
+    // The image is position-independent: a copy at a different (unaligned) address works too.
+    auto moved_image = evmone::bytes(1, 0) + image;
+    EXPECT_TRUE(deserialize(evmone::bytes_view{moved_image}.substr(1), rev).has_value());
+}
+
+TEST(analysis, serialize_empty)
+{
+    const auto analysis = analyze(rev, {});
+    const auto loaded = deserialize(serialize(analysis, rev), rev);
+    ASSERT_TRUE(loaded.has_value());
+    ASSERT_EQ(loaded->instrs.size(), 2);
+    EXPECT_EQ(loaded->instrs[0].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(loaded->instrs[1].opcode(), OP_STOP);
+    EXPECT_TRUE(loaded->push_values.empty());
+    EXPECT_TRUE(loaded->jumpdest_offsets.empty());
+}
+
+TEST(analysis, deserialize_invalid)
+{
+    const auto code = push("00112233445566778899aabbccddeeff") + OP_JUMPDEST + OP_POP;
+    const auto image = serialize(analyze(rev, code), rev);
+    ASSERT_TRUE(deserialize(image, rev).has_value());
+
+    EXPECT_FALSE(deserialize({}, rev).has_value());
+    EXPECT_FALSE(
+        deserialize(evmone::bytes_view{image}.substr(0, image.size() - 1), rev).has_value());
+    EXPECT_FALSE(deserialize(image + uint8_t{0}, rev).has_value());
+    EXPECT_FALSE(deserialize(image, EVMC_PETERSBURG).has_value());
+
+    auto bad_magic = image;
+    bad_magic[0] = 'X';
+    EXPECT_FALSE(deserialize(bad_magic, rev).has_value());
+
+    // The header is 40 bytes, each instruction takes 4 bytes: the opcode and the 24-bit argument.
+    auto bad_block_index = image;
+    bad_block_index[40 + 1] = 2;
+    EXPECT_FALSE(deserialize(bad_block_index, rev).has_value());
+
+    auto bad_push_value_index = image;
+    bad_push_value_index[40 + 4 + 1] = 1;
+    EXPECT_FALSE(deserialize(bad_push_value_index, rev).has_value());
+
+    auto no_final_stop = image;
+    no_final_stop[40 + 4 * 4] = OP_POP;
+    EXPECT_FALSE(deserialize(no_final_stop, rev).has_value());
+}
+
+TEST(analysis, deserialize_unsafe)
+{
+    const auto code = push(1) + OP_JUMPDEST + OP_POP;
+    const auto analysis = analyze(rev, code);
+    ASSERT_EQ(analysis.instrs.size(), 5);
+    ASSERT_EQ(analysis.blocks.size(), 2);
+    const auto image = serialize(analysis, rev);
+    ASSERT_TRUE(deserialize(image, rev).has_value());
+
+    // The image layout: the 40-byte header, the instructions, the blocks, the push values,
+    // the partial block costs, the JUMPDEST offsets and targets.
+    const auto blocks_pos = 40 + analysis.instrs.size() * 4;
+    const auto jumpdest_targets_pos = blocks_pos + analysis.blocks.size() * 8 +
+                                      analysis.push_values.size() * 32 +
+                                      analysis.partial_block_costs.size() * 4 +
+                                      analysis.jumpdest_offsets.size() * 4;
+
+    // The JUMPDEST target must be the beginning of a block, not the PUSH1.
+    auto bad_jumpdest_target = image;
+    bad_jumpdest_target[jumpdest_targets_pos] = 1;
+    EXPECT_FALSE(deserialize(bad_jumpdest_target, rev).has_value());
+
+    // The POP requires 1 stack item: the block of the JUMPDEST must check it.
+    auto low_stack_req = image;
+    low_stack_req[blocks_pos + 8 + 4] = 0;
+    EXPECT_FALSE(deserialize(low_stack_req, rev).has_value());
+
+    // The PUSH1 grows the stack: the first block must check it.
+    auto low_stack_max_growth = image;
+    low_stack_max_growth[blocks_pos + 6] = 0;
+    EXPECT_FALSE(deserialize(low_stack_max_growth, rev).has_value());
+
+    // The block gas cost cannot be lower than the cost of its instructions.
+    auto low_gas_cost = image;
+    low_gas_cost[blocks_pos] = 0;
+    EXPECT_FALSE(deserialize(low_gas_cost, rev).has_value());
+
+    // The first instruction must begin a block.
+    auto no_first_block = image;
+    no_first_block[40] = OP_ADDRESS;
+    EXPECT_FALSE(deserialize(no_first_block, rev).has_value());
+}
+
+TEST(analysis, find_jumpdest_index)
+{
+    // JUMPDESTs spread over multiple 64-byte chunks, including chunk boundaries.
+    auto code = bytecode{bytes(300, OP_ADDRESS)};
+    for (const auto offset : {0, 7, 14, 62, 63, 64, 127, 128, 191, 256, 299})
+        code[static_cast<size_t>(offset)] = OP_JUMPDEST;
+    const auto analysis = analyze(rev, code);
+    ASSERT_EQ(analysis.jumpdest_offsets.size(), 11);
+    EXPECT_EQ(analysis.jumpdest_index.size(), 5);
+
+    const auto& offsets = analysis.jumpdest_offsets;
+    for (int offset = -65; offset < 400; ++offset)
+    {
+        const auto it = std::find(offsets.begin(), offsets.end(), offset);
+        const auto expected =
+            it != offsets.end() ? analysis.jumpdest_targets[size_t(it - offsets.begin())] : -1;
+        EXPECT_EQ(find_jumpdest(analysis, offset), expected) << offset;
+    }
+    EXPECT_EQ(find_jumpdest(analysis, std::numeric_limits<int>::max()), -1);
+    EXPECT_EQ(find_jumpdest(analysis, std::numeric_limits<int>::min()), -1);
+}
+
+TEST(analysis, fold_constants)
+{
+    const auto code =
+        push(2) + push(4) + OP_SUB + push(3) + OP_MUL + OP_ISZERO + OP_ISZERO + OP_SSTORE;
+    const auto analysis = analyze(rev, code);
+
+    ASSERT_EQ(analysis.instrs.size(), 4);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[1].arg(), 1);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_SSTORE);
+    EXPECT_TRUE(analysis.push_values.empty());
+
+    // The gas cost and the stack requirements of the original instructions are kept.
+    const auto& block = analysis.blocks[analysis.instrs[0].arg()];
+    EXPECT_EQ(block.gas_cost, uint32_t{3 * 3 + 3 + 5 + 2 * 3});
+    EXPECT_EQ(block.stack_req, 1);
+    EXPECT_EQ(block.stack_max_growth, 2);
+
+    // The SSTORE still accounts for the gas cost of the folded instructions.
+    EXPECT_EQ(analysis.partial_block_costs[analysis.instrs[2].arg()], block.gas_cost);
+}
+
+TEST(analysis, fold_constants_large_values)
+{
+    // The result not fitting the instruction argument reuses the push_values slot
+    // of the arguments. Otherwise it is not folded.
+    const auto code = push(0) + OP_NOT + push("ffffffffffff") + push(0xff) + OP_SHL + OP_ADD;
+    const auto analysis = analyze(EVMC_CONSTANTINOPLE, code);
+
+    ASSERT_EQ(analysis.instrs.size(), 6);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_NOT);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_PUSH32);
+    ASSERT_EQ(analysis.push_values.size(), 1);
+    EXPECT_EQ(analysis.push_values[analysis.instrs[3].arg()], intx::uint256{1} << 0xff);
+    EXPECT_EQ(analysis.instrs[4].opcode(), OP_ADD);
+}
+
+TEST(analysis, fold_constants_limits)
+{
+    // Not folded: the result would need a new push value, the instruction is not pure,
+    // the arguments are in different blocks.
+    const auto code = push(1) + push(0xff) + OP_SHL + push(0) + push(0) + OP_EXP + push(1) +
+                      push(1) + OP_SHL + push(1) + OP_JUMPDEST + OP_ISZERO;
+    const auto analysis = analyze(EVMC_CONSTANTINOPLE, code);
+    ASSERT_EQ(analysis.instrs.size(), 12);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_SHL);
+    EXPECT_EQ(analysis.instrs[6].opcode(), OP_EXP);
+    EXPECT_EQ(analysis.instrs[7].opcode(), OP_PUSH1);
+    EXPECT_EQ(analysis.instrs[7].arg(), 2);  // Folded SHL.
+    EXPECT_EQ(analysis.instrs[10].opcode(), OP_ISZERO);
+
+    // The instruction undefined in the revision is not folded.
+    const auto byzantium_analysis = analyze(EVMC_BYZANTIUM, code);
+    ASSERT_EQ(byzantium_analysis.instrs.size(), 14);
+    EXPECT_EQ(byzantium_analysis.instrs[9].opcode(), OPX_UNDEFINED);
+}
+
+TEST(analysis, remove_stack_noops)
+{
+    const auto code = bytecode{OP_DUP3} + OP_POP + OP_SWAP2 + OP_SWAP2 + OP_SWAP1 + OP_SWAP2 +
+                      OP_DUP1 + OP_SWAP1 + OP_SWAP1 + OP_POP + OP_POP;
+    const auto analysis = analyze(rev, code);
+
+    ASSERT_EQ(analysis.instrs.size(), 5);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OP_SWAP1);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_SWAP2);
+    EXPECT_EQ(analysis.instrs[3].opcode(), OP_POP);
+
+    const auto& block = analysis.blocks[analysis.instrs[0].arg()];
+    EXPECT_EQ(block.gas_cost, uint32_t{3 * 8 + 2 * 3});
+    EXPECT_EQ(block.stack_req, 3);
+    EXPECT_EQ(block.stack_max_growth, 1);
+}
+
+TEST(analysis, jump_direct)
+{
+    const auto code = push(7) + OP_JUMP + OP_JUMPDEST + push(3) + OP_JUMP + OP_JUMPDEST +
+                      push(0xff) + OP_JUMP + OP_JUMPDEST + push(4) + OP_JUMP;
+    const auto analysis = analyze(rev, code);
+
+    ASSERT_EQ(analysis.instrs.size(), 9);
+    EXPECT_EQ(analysis.instrs[1], (Instruction{OPX_JUMP_DIRECT, 4}));  // Forward jump.
+    EXPECT_EQ(analysis.instrs[2].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[3], (Instruction{OPX_JUMP_DIRECT, 2}));  // Backward jump.
+    EXPECT_EQ(analysis.instrs[4].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.instrs[5], (Instruction{OPX_JUMP_DIRECT, Instruction::max_arg}));
+    EXPECT_EQ(analysis.instrs[7], (Instruction{OPX_JUMP_DIRECT, Instruction::max_arg}));
+    EXPECT_EQ(analysis.blocks[analysis.instrs[0].arg()].gas_cost, 3 + 8);
+
+    // The direct jumps survive the serialization.
+    const auto loaded = deserialize(serialize(analysis, rev), rev);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->instrs, analysis.instrs);
+}
+
+TEST(analysis, intrinsic_opcodes_in_code)
+{
+    const auto code = bytecode{"0d0c"};
+    const auto analysis = analyze(rev, code);
+
+    ASSERT_EQ(analysis.instrs.size(), 4);
+    EXPECT_EQ(analysis.instrs[1].opcode(), OPX_UNDEFINED);
+    EXPECT_EQ(analysis.instrs[2].opcode(), OPX_UNDEFINED);
+}
+
+TEST(analysis, eof1_code_sections)
+{
+    const auto code =
+        "EF00 01 010008 020002 000f 0002 030000 00 00000002 02010002 6001 6008 b00001" +
+        ret_top() + "03b1";
+    const auto analysis = analyze_eof1(EVMC_CANCUN, code);
+
+    ASSERT_EQ(analysis.instrs.size(), 14);
+    EXPECT_EQ(analysis.instrs[3], (Instruction{OP_CALLF, 1}));
+    EXPECT_EQ(analysis.instrs[4].opcode(), OPX_BEGINBLOCK);  // The CALLF return address.
+    EXPECT_EQ(analysis.instrs[10].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[11].opcode(), OP_ADD);
+    EXPECT_EQ(analysis.instrs[12].opcode(), OP_RETF);
+    EXPECT_EQ(analysis.instrs[13].opcode(), OP_STOP);
+
+    ASSERT_EQ(analysis.code_sections.size(), 2);
+    EXPECT_EQ(analysis.code_sections[0], (AdvancedCodeSection{0, 2}));
+    EXPECT_EQ(analysis.code_sections[1], (AdvancedCodeSection{10, 2}));
+
+    // The stack effect of the CALLF is taken from the type of the called section.
+    ASSERT_EQ(analysis.blocks.size(), 3);
+    EXPECT_EQ(analysis.blocks[0], (BlockInfo{3 + 3 + 5, 0, 2}));
+    EXPECT_EQ(analysis.blocks[2], (BlockInfo{3 + 3, 2, 0}));
+
+    const auto loaded = deserialize(serialize(analysis, EVMC_CANCUN), EVMC_CANCUN);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->instrs, analysis.instrs);
+    EXPECT_EQ(loaded->code_sections, analysis.code_sections);
+}
+
+TEST(analysis, eof1_relative_jumps)
+{
+    const auto code =
+        eof1_bytecode(rjumpi(1, OP_CALLDATASIZE) + OP_STOP + rjumpv({-7, 1}, OP_CALLDATASIZE) +
+                          OP_STOP + OP_JUMPDEST + OP_STOP,
+            1);
+    const auto analysis = analyze_eof1(EVMC_CANCUN, code);
+
+    ASSERT_EQ(analysis.instrs.size(), 13);
+    EXPECT_EQ(analysis.instrs[2], (Instruction{OP_RJUMPI, 5}));
+    EXPECT_EQ(analysis.instrs[3].opcode(), OPX_BEGINBLOCK);  // The follow-by block.
+    EXPECT_EQ(analysis.instrs[5].opcode(), OPX_BEGINBLOCK);  // The jump destination block.
+    EXPECT_EQ(analysis.instrs[7], (Instruction{OP_RJUMPV, 0}));
+    EXPECT_EQ(analysis.instrs[8].opcode(), OPX_BEGINBLOCK);
+    EXPECT_EQ(analysis.instrs[10].opcode(), OP_JUMPDEST);
+    EXPECT_EQ(analysis.jump_tables, (std::vector<uint32_t>{2, 5, 10}));
+    EXPECT_EQ(analysis.blocks.size(), 5);
+    EXPECT_TRUE(analysis.jumpdest_offsets.empty());
+
+    const auto loaded = deserialize(serialize(analysis, EVMC_CANCUN), EVMC_CANCUN);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->jump_tables, analysis.jump_tables);
+
+    // The jump destination must be the beginning of a block.
+    auto image = serialize(analysis, EVMC_CANCUN);
+    image[40 + 2 * 4 + 1] = 6;
+    EXPECT_FALSE(deserialize(image, EVMC_CANCUN).has_value());
+}
@@ -0,0 +1,114 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "test/utils/bytecode.hpp"
+#include <evmc/evmc.hpp>
+#include <evmc/mocked_host.hpp>
+#include <evmone/coverage.hpp>
+#include <evmone/evmone.h>
+#include <evmone/vm.hpp>
+#include <gmock/gmock.h>
+#include <test/state/hash_utils.hpp>
+#include <sstream>
+
+using namespace testing;
+
+namespace
+{
+// The JUMPI to the JUMPDEST at 7 if the first calldata word is not zero.
+// The basic blocks start at 0, 6 (JUMPI fallthrough), 7 and 9 (dead code).
+const auto code = push(0) + OP_CALLDATALOAD + push(7) + OP_JUMPI + OP_STOP + OP_JUMPDEST +
+                  OP_STOP + OP_JUMPDEST + push(0x5b) + OP_STOP;
+}  // namespace
+
+TEST(coverage, basic_blocks)
+{
+    ASSERT_EQ(code.size(), 13);
+    const auto code_hash = evmone::keccak256(code);
+
+    evmc::VM vm{evmc_create_evmone()};
+    ASSERT_EQ(vm.set_option("coverage", ""), EVMC_SET_OPTION_SUCCESS);
+    const auto& coverage = *static_cast<evmone::VM*>(vm.get_raw_pointer())->get_coverage();
+    EXPECT_EQ(coverage.find(code_hash), nullptr);
+
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000000;
+    ASSERT_EQ(vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size()).status_code,
+        EVMC_SUCCESS);
+
+    ASSERT_EQ(coverage.size(), 1);
+    const auto* code_coverage = coverage.find(code_hash);
+    ASSERT_NE(code_coverage, nullptr);
+    EXPECT_EQ(code_coverage->code_size, code.size());
+    EXPECT_EQ(code_coverage->num_blocks(), 4);
+    EXPECT_EQ(code_coverage->num_executed_blocks(), 2);
+    EXPECT_THAT(code_coverage->unexecuted_blocks(), ElementsAre(7, 9));
+
+    // Take the jump. The coverage of the same code is accumulated.
+    const auto input = evmc::bytes32{1};
+    msg.input_data = input.bytes;
+    msg.input_size = sizeof(input);
+    ASSERT_EQ(vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size()).status_code,
+        EVMC_SUCCESS);
+
+    ASSERT_EQ(coverage.size(), 1);
+    EXPECT_EQ(code_coverage->num_executed_blocks(), 3);
+    EXPECT_THAT(code_coverage->unexecuted_blocks(), ElementsAre(9));
+
+    std::ostringstream report;
+    coverage.report(report);
+    EXPECT_EQ(report.str(), "code_hash,code_size,blocks,executed_blocks\n0x" +
+                                evmc::hex({code_hash.bytes, sizeof(code_hash.bytes)}) +
+                                ",13,4,3\n");
+}
+
+TEST(coverage, not_collected)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    ASSERT_EQ(vm.set_option("coverage", ""), EVMC_SET_OPTION_SUCCESS);
+    auto& evmone_vm = *static_cast<evmone::VM*>(vm.get_raw_pointer());
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000000;
+
+    // The coverage is not collected for the EOF code.
+    const auto eof_code = eof1_bytecode(OP_STOP);
+    ASSERT_EQ(vm.execute(host, EVMC_CANCUN, msg, eof_code.data(), eof_code.size()).status_code,
+        EVMC_SUCCESS);
+    EXPECT_EQ(evmone_vm.get_coverage()->size(), 0);
+
+    // The coverage is not collected when tracing.
+    std::ostringstream histogram;
+    evmone_vm.add_tracer(evmone::create_histogram_tracer(histogram));
+    ASSERT_EQ(vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size()).status_code,
+        EVMC_SUCCESS);
+    EXPECT_EQ(evmone_vm.get_coverage()->size(), 0);
+}
+
+TEST(coverage, code_at_same_address)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    ASSERT_EQ(vm.set_option("coverage", ""), EVMC_SET_OPTION_SUCCESS);
+    const auto& coverage = *static_cast<evmone::VM*>(vm.get_raw_pointer())->get_coverage();
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000000;
+
+    // The buffer of the executed code is reused for another code of the same size.
+    auto buffer = code;
+    ASSERT_EQ(vm.execute(host, EVMC_SHANGHAI, msg, buffer.data(), buffer.size()).status_code,
+        EVMC_SUCCESS);
+    buffer[1] = 0x01;  // PUSH1 1 instead of PUSH1 0.
+    ASSERT_EQ(vm.execute(host, EVMC_SHANGHAI, msg, buffer.data(), buffer.size()).status_code,
+        EVMC_SUCCESS);
+
+    ASSERT_EQ(coverage.size(), 2);
+    const auto* first = coverage.find(evmone::keccak256(code));
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first->num_executed_blocks(), 2);
+    const auto* second = coverage.find(evmone::keccak256(buffer));
+    ASSERT_NE(second, nullptr);
+    EXPECT_EQ(second->num_executed_blocks(), 2);
+}
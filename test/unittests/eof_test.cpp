@@ -47,8 +47,44 @@ TEST(eof, read_valid_eof1_header)
     {
         const auto code = from_spaced_hex(test_case.code).value();
         const auto header = read_valid_eof1_header(code);
-        EXPECT_EQ(header.code_sizes[0], test_case.code_size) << test_case.code;
+        EXPECT_EQ(header.get_code_size(code, 0), test_case.code_size) << test_case.code;
         EXPECT_EQ(header.data_size, test_case.data_size) << test_case.code;
-        EXPECT_EQ(header.types.size() * 4, test_case.types_size) << test_case.code;
+        EXPECT_EQ(header.code_sections_offset - header.types_offset, test_case.types_size)
+            << test_case.code;
+        EXPECT_EQ(header.data_offset + header.data_size, code.size()) << test_case.code;
+    }
+}
+
+TEST(eof, read_valid_eof1_header_many_code_sections)
+{
+    // More code sections than the header stores the offsets inline.
+    constexpr size_t num_sections = EOF1Header::max_inline_code_sections + 3;
+    auto code = from_spaced_hex("EF00 01 010000 020000").value();
+    code[5] = static_cast<uint8_t>(num_sections * 4);
+    code[8] = static_cast<uint8_t>(num_sections);
+    for (size_t i = 0; i < num_sections; ++i)
+        code += bytes{0x00, static_cast<uint8_t>(i + 1)};  // Section i has size i + 1.
+    code += from_spaced_hex("030002 00").value();
+    for (size_t i = 0; i < num_sections; ++i)
+        code += bytes{0x00, 0x00, 0x00, static_cast<uint8_t>(i)};
+    for (size_t i = 0; i < num_sections; ++i)
+        code += bytes(i + 1, static_cast<uint8_t>(i));
+    code += bytes{0xAA, 0xBB};
+
+    const auto header = read_valid_eof1_header(code);
+    EXPECT_EQ(header.version, 1);
+    ASSERT_EQ(header.num_code_sections, num_sections);
+    EXPECT_EQ(header.data_size, 2);
+    EXPECT_EQ(header.get_code_sections(code).size(), num_sections * (num_sections + 1) / 2);
+    EXPECT_EQ(bytes(code.substr(header.data_offset)), (bytes{0xAA, 0xBB}));
+
+    uint32_t offset = 0;
+    for (size_t i = 0; i < num_sections; ++i)
+    {
+        EXPECT_EQ(header.get_code_size(code, i), i + 1);
+        EXPECT_EQ(header.get_code_offset(code, i), offset);
+        EXPECT_EQ(header.get_code(code, i), bytes(i + 1, static_cast<uint8_t>(i)));
+        EXPECT_EQ(header.get_type(code, i).max_stack_height, i);
+        offset += static_cast<uint32_t>(i + 1);
     }
 }
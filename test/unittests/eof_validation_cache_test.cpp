@@ -0,0 +1,57 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <evmone/eof_validation_cache.hpp>
+#include <gtest/gtest.h>
+#include <test/utils/bytecode.hpp>
+
+using namespace evmone;
+
+TEST(eof_validation_cache, validate)
+{
+    const auto valid = eof1_bytecode(OP_STOP);
+    const auto invalid = eof1_bytecode(OP_ADD);
+    const auto invalid_error = validate_eof(EVMC_CANCUN, invalid);
+    ASSERT_NE(invalid_error, EOFValidationError::success);
+
+    EOFValidationCache cache;
+    EXPECT_EQ(cache.validate(EVMC_CANCUN, valid), EOFValidationError::success);
+    EXPECT_EQ(cache.validate(EVMC_CANCUN, invalid), invalid_error);
+    EXPECT_EQ(cache.hits(), 0);
+    EXPECT_EQ(cache.misses(), 2);
+    EXPECT_EQ(cache.size(), 2);
+
+    EXPECT_EQ(cache.validate(EVMC_CANCUN, invalid), invalid_error);
+    EXPECT_EQ(cache.validate(EVMC_CANCUN, valid), EOFValidationError::success);
+    EXPECT_EQ(cache.hits(), 2);
+    EXPECT_EQ(cache.misses(), 2);
+
+    // The result depends on the revision.
+    EXPECT_EQ(cache.validate(EVMC_SHANGHAI, valid), EOFValidationError::eof_version_unknown);
+    EXPECT_EQ(cache.misses(), 3);
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.validate(EVMC_CANCUN, valid), EOFValidationError::success);
+    EXPECT_EQ(cache.misses(), 4);
+}
+
+TEST(eof_validation_cache, bounded_size)
+{
+    EOFValidationCache cache;
+    for (size_t i = 0; i <= EOFValidationCache::max_entries; ++i)
+    {
+        const auto code = eof1_bytecode(push(i) + OP_POP + OP_STOP, 1);
+        ASSERT_EQ(cache.validate(EVMC_CANCUN, code), EOFValidationError::success);
+    }
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_EQ(cache.misses(), EOFValidationCache::max_entries + 1);
+}
+
+TEST(eof_validation_cache, validate_eof_cached)
+{
+    const auto code = eof1_bytecode(OP_STOP);
+    EXPECT_EQ(validate_eof_cached(EVMC_CANCUN, code), validate_eof(EVMC_CANCUN, code));
+    EXPECT_EQ(validate_eof_cached(EVMC_CANCUN, code), EOFValidationError::success);
+}
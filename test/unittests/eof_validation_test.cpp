@@ -225,12 +225,13 @@ TEST(eof_validation, EOF1_code_section_offset)
     ASSERT_EQ(validate_eof(EVMC_CANCUN, eof), EOFValidationError::success);
 
     const auto header = read_valid_eof1_header(eof);
-    ASSERT_EQ(header.code_sizes.size(), 2);
-    EXPECT_EQ(header.code_sizes[0], 3);
-    EXPECT_EQ(header.code_sizes[1], 1);
-    ASSERT_EQ(header.code_offsets.size(), 2);
-    EXPECT_EQ(header.code_offsets[0], 25);
-    EXPECT_EQ(header.code_offsets[1], 28);
+    ASSERT_EQ(header.num_code_sections, 2);
+    EXPECT_EQ(header.get_code_size(eof, 0), 3);
+    EXPECT_EQ(header.get_code_size(eof, 1), 1);
+    EXPECT_EQ(header.code_sections_offset, 25);
+    EXPECT_EQ(header.get_code_offset(eof, 0), 0);
+    EXPECT_EQ(header.get_code_offset(eof, 1), 3);
+    EXPECT_EQ(header.data_offset, 29);
 }
 
 TEST(eof_validation, EOF1_trailing_bytes)
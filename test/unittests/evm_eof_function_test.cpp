@@ -9,10 +9,6 @@ using evmone::test::evm;
 
 TEST_P(evm, eof_function_example1)
 {
-    // Relative jumps are not implemented in Advanced.
-    if (is_advanced())
-        return;
-
     rev = EVMC_CANCUN;
     const auto code =
         "EF00 01 010008 020002 000f 0002 030000 00"
@@ -29,10 +25,6 @@ TEST_P(evm, eof_function_example1)
 
 TEST_P(evm, eof_function_example2)
 {
-    // Relative jumps are not implemented in Advanced.
-    if (is_advanced())
-        return;
-
     rev = EVMC_CANCUN;
     const auto code =
         "ef0001 01000c 020003 003b 0017 001d 030000 00 00000004 01010003 01010004"
@@ -60,10 +52,6 @@ TEST_P(evm, eof_function_example2)
 
 TEST_P(evm, callf_stack_size_1024)
 {
-    // CALLF is not implemented in Advanced.
-    if (is_advanced())
-        return;
-
     rev = EVMC_CANCUN;
     const auto code = bytecode{"ef0001 010008 020002 0BFF 0004 030000 00 000003FF 00000001"_hex} +
                       1023 * push(1) + OP_CALLF + bytecode{"0x0001"_hex} + 1021 * OP_POP +
@@ -76,10 +64,6 @@ TEST_P(evm, callf_stack_size_1024)
 
 TEST_P(evm, callf_stack_overflow)
 {
-    // CALLF is not implemented in Advanced.
-    if (is_advanced())
-        return;
-
     rev = EVMC_CANCUN;
     const auto code =
         bytecode{"ef0001 010008 020002 0BFF 0007 030000 00 000003FF 00000002"_hex} +  // EOF header
@@ -93,10 +77,6 @@ TEST_P(evm, callf_stack_overflow)
 
 TEST_P(evm, callf_call_stack_size_1024)
 {
-    // CALLF is not implemented in Advanced.
-    if (is_advanced())
-        return;
-
     rev = EVMC_CANCUN;
     const auto code = bytecode{"ef0001 010008 020002 0007 000e 030000 00 00000001 01000002"_hex} +
                       push(1023) + OP_CALLF + bytecode{"0x0001"_hex} + OP_STOP + OP_DUP1 +
@@ -110,10 +90,6 @@ TEST_P(evm, callf_call_stack_size_1024)
 
 TEST_P(evm, callf_call_stack_size_1025)
 {
-    // CALLF is not implemented in Advanced.
-    if (is_advanced())
-        return;
-
     rev = EVMC_CANCUN;
     const auto code = bytecode{"ef0001 010008 020002 0007 000e 030000 00 00000001 01000002"_hex} +
                       push(1024) + OP_CALLF + bytecode{"0x0001"_hex} + OP_STOP + OP_DUP1 +
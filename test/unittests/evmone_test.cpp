@@ -4,6 +4,7 @@
 
 #include <evmc/evmc.hpp>
 #include <evmone/evmone.h>
+#include <evmone/sampler.hpp>
 #include <evmone/vm.hpp>
 #include <gtest/gtest.h>
 
@@ -53,3 +54,75 @@ TEST(evmone, set_option_cgoto)
     EXPECT_EQ(vm.set_option("cgoto", "no"), EVMC_SET_OPTION_INVALID_NAME);
 #endif
 }
+
+TEST(evmone, set_option_sampling)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    const auto& evmone_vm = *static_cast<evmone::VM*>(vm.get_raw_pointer());
+    EXPECT_EQ(evmone_vm.get_sampler(), nullptr);
+    EXPECT_EQ(vm.set_option("sampling", "0"), EVMC_SET_OPTION_INVALID_VALUE);
+    EXPECT_EQ(vm.set_option("sampling", "-1"), EVMC_SET_OPTION_INVALID_VALUE);
+    EXPECT_EQ(vm.set_option("sampling", "1x"), EVMC_SET_OPTION_INVALID_VALUE);
+    EXPECT_EQ(evmone_vm.get_sampler(), nullptr);
+    EXPECT_EQ(vm.set_option("sampling", ""), EVMC_SET_OPTION_SUCCESS);
+    ASSERT_NE(evmone_vm.get_sampler(), nullptr);
+    EXPECT_EQ(evmone_vm.get_sampler()->period(), evmone::Sampler::default_period);
+    EXPECT_EQ(vm.set_option("sampling", "1000"), EVMC_SET_OPTION_SUCCESS);
+    ASSERT_NE(evmone_vm.get_sampler(), nullptr);
+    EXPECT_EQ(evmone_vm.get_sampler()->period(), 1000);
+    EXPECT_EQ(vm.set_option("sampling", "no"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_EQ(evmone_vm.get_sampler(), nullptr);
+}
+
+TEST(evmone, set_option_coverage_report)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    EXPECT_EQ(vm.set_option("coverage_report", ""), EVMC_SET_OPTION_INVALID_VALUE);
+}
+
+namespace
+{
+/// The VM option enabling a VM feature: empty value or "yes" enables it, "no" disables it.
+struct YesNoOption
+{
+    const char* name;
+    bool (*is_enabled)(const evmone::VM& vm) noexcept;
+};
+
+const YesNoOption yes_no_options[]{
+    {"coverage", [](const evmone::VM& vm) noexcept { return vm.get_coverage() != nullptr; }},
+    {"keccak_cache",
+        [](const evmone::VM& vm) noexcept { return vm.get_keccak_cache() != nullptr; }},
+    {"stats", [](const evmone::VM& vm) noexcept { return vm.get_stats() != nullptr; }},
+};
+
+class evmone_yes_no_option : public testing::TestWithParam<YesNoOption>
+{};
+
+std::string print_option_name(const testing::TestParamInfo<YesNoOption>& info)
+{
+    return info.param.name;
+}
+}  // namespace
+
+TEST_P(evmone_yes_no_option, set_option)
+{
+    const auto& [name, is_enabled] = GetParam();
+    evmc::VM vm{evmc_create_evmone()};
+    const auto& evmone_vm = *static_cast<evmone::VM*>(vm.get_raw_pointer());
+
+    EXPECT_FALSE(is_enabled(evmone_vm));
+    EXPECT_EQ(vm.set_option(name, "maybe"), EVMC_SET_OPTION_INVALID_VALUE);
+    EXPECT_FALSE(is_enabled(evmone_vm));
+    EXPECT_EQ(vm.set_option(name, ""), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_TRUE(is_enabled(evmone_vm));
+    EXPECT_EQ(vm.set_option(name, "maybe"), EVMC_SET_OPTION_INVALID_VALUE);
+    EXPECT_TRUE(is_enabled(evmone_vm));
+    EXPECT_EQ(vm.set_option(name, "no"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_FALSE(is_enabled(evmone_vm));
+    EXPECT_EQ(vm.set_option(name, "yes"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_TRUE(is_enabled(evmone_vm));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    evmone, evmone_yes_no_option, testing::ValuesIn(yes_no_options), print_option_name);
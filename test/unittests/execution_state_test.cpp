@@ -86,6 +86,7 @@ TEST(execution_state, reset_advanced)
     st.output_size = 4;
     st.current_block_cost = 5;
     st.analysis.advanced = &analysis;
+    st.call_stack.push(nullptr);
 
     EXPECT_EQ(st.gas_left, 1);
     EXPECT_EQ(st.gas_refund, 2);
@@ -99,6 +100,7 @@ TEST(execution_state, reset_advanced)
     EXPECT_EQ(st.output_size, 4u);
     EXPECT_EQ(st.current_block_cost, 5u);
     EXPECT_EQ(st.analysis.advanced, &analysis);
+    EXPECT_EQ(st.call_stack.size(), 1);
 
     {
         evmc_message msg2{};
@@ -122,6 +124,7 @@ TEST(execution_state, reset_advanced)
         EXPECT_EQ(st.output_size, 0);
         EXPECT_EQ(st.current_block_cost, 0u);
         EXPECT_EQ(st.analysis.advanced, nullptr);
+        EXPECT_EQ(st.call_stack.size(), 0);
     }
 }
 
@@ -172,3 +175,23 @@ TEST(execution_state, memory_view)
     EXPECT_EQ(view[1], 0x00);
     EXPECT_EQ(view[2], 0xc2);
 }
+
+TEST(execution_state, return_stack)
+{
+    evmone::ReturnStack<size_t> rs;
+    EXPECT_EQ(rs.size(), 0);
+    EXPECT_FALSE(rs.full());
+
+    for (size_t i = 0; i < rs.limit; ++i)
+        rs.push(i);
+    EXPECT_EQ(rs.size(), rs.limit);
+    EXPECT_TRUE(rs.full());
+
+    EXPECT_EQ(rs.pop(), rs.limit - 1);
+    EXPECT_EQ(rs.pop(), rs.limit - 2);
+    EXPECT_EQ(rs.size(), rs.limit - 2);
+    EXPECT_FALSE(rs.full());
+
+    rs.clear();
+    EXPECT_EQ(rs.size(), 0);
+}
@@ -0,0 +1,60 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "test/utils/bytecode.hpp"
+#include <evmc/evmc.hpp>
+#include <evmc/mocked_host.hpp>
+#include <evmone/evmone.h>
+#include <evmone/execution_stats.hpp>
+#include <evmone/vm.hpp>
+#include <gtest/gtest.h>
+
+using evmone::HostCall;
+
+TEST(execution_stats, execution)
+{
+    // 10 instructions + the implicit STOP.
+    const auto code = sstore(1, sload(2)) + mstore(64, 1) + push(0) + OP_BALANCE + OP_POP;
+
+    evmc::VM vm{evmc_create_evmone()};
+    ASSERT_EQ(vm.set_option("stats", ""), EVMC_SET_OPTION_SUCCESS);
+    const auto& stats = *static_cast<evmone::VM*>(vm.get_raw_pointer())->get_stats();
+
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000000;
+    ASSERT_EQ(vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size()).status_code,
+        EVMC_SUCCESS);
+
+    EXPECT_EQ(stats.num_executions, 1);
+    EXPECT_EQ(stats.num_instructions, 11);
+    EXPECT_EQ(stats.peak_stack_height, 2);
+    EXPECT_EQ(stats.peak_memory_size, 96);
+    EXPECT_EQ(stats.num_host_calls_of(HostCall::access_storage), 2);
+    EXPECT_EQ(stats.num_host_calls_of(HostCall::get_storage), 1);
+    EXPECT_EQ(stats.num_host_calls_of(HostCall::set_storage), 1);
+    EXPECT_EQ(stats.num_host_calls_of(HostCall::access_account), 1);
+    EXPECT_EQ(stats.num_host_calls_of(HostCall::get_balance), 1);
+    EXPECT_EQ(stats.num_host_calls_of(HostCall::call), 0);
+
+    // The nested execution adds to the stats of the transaction.
+    msg.depth = 1;
+    ASSERT_EQ(vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size()).status_code,
+        EVMC_SUCCESS);
+    EXPECT_EQ(stats.num_executions, 2);
+    EXPECT_EQ(stats.num_instructions, 22);
+    EXPECT_EQ(stats.peak_stack_height, 2);
+    EXPECT_EQ(stats.num_host_calls_of(HostCall::get_storage), 2);
+
+    // The next transaction resets the stats.
+    msg.depth = 0;
+    const auto stop = bytecode{OP_STOP};
+    ASSERT_EQ(vm.execute(host, EVMC_SHANGHAI, msg, stop.data(), stop.size()).status_code,
+        EVMC_SUCCESS);
+    EXPECT_EQ(stats.num_executions, 1);
+    EXPECT_EQ(stats.num_instructions, 1);
+    EXPECT_EQ(stats.peak_stack_height, 0);
+    EXPECT_EQ(stats.peak_memory_size, 0);
+    EXPECT_EQ(stats.num_host_calls_of(HostCall::get_storage), 0);
+}
@@ -0,0 +1,124 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "test/utils/bytecode.hpp"
+#include <evmc/evmc.hpp>
+#include <evmc/mocked_host.hpp>
+#include <evmone/evmone.h>
+#include <evmone/histogram.hpp>
+#include <gtest/gtest.h>
+#include <test/state/hash_utils.hpp>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+void execute(evmc_revision rev, const bytecode& code, int times)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    EXPECT_EQ(vm.set_option("histogram_collect", ""), EVMC_SET_OPTION_SUCCESS);
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000000;
+    for (int i = 0; i < times; ++i)
+        EXPECT_EQ(vm.execute(host, rev, msg, code.data(), code.size()).status_code, EVMC_SUCCESS);
+}
+}  // namespace
+
+TEST(histogram, aggregation)
+{
+    const auto code = push(1) + push(2) + OP_ADD + push(0) + OP_MSTORE;
+    const auto code_hash = evmone::keccak256(code);
+
+    evmone_histogram_reset();
+    EXPECT_EQ(evmone_histogram_snapshot(nullptr, 0), 0);
+
+    // The counts from different VMs and threads are merged.
+    std::thread t1{execute, EVMC_SHANGHAI, code, 3};
+    std::thread t2{execute, EVMC_SHANGHAI, code, 2};
+    t1.join();
+    t2.join();
+    execute(EVMC_LONDON, code, 1);
+
+    ASSERT_EQ(evmone_histogram_snapshot(nullptr, 0), 2);
+    evmone_histogram_entry entries[3]{};
+    ASSERT_EQ(evmone_histogram_snapshot(entries, std::size(entries)), 2);
+
+    EXPECT_EQ(entries[0].rev, EVMC_LONDON);
+    EXPECT_EQ(evmc::bytes32{entries[0].code_hash}, code_hash);
+    EXPECT_EQ(entries[0].counts[OP_PUSH1], 3);
+    EXPECT_EQ(entries[0].counts[OP_ADD], 1);
+    EXPECT_EQ(entries[0].counts[OP_MSTORE], 1);
+    EXPECT_EQ(entries[1].rev, EVMC_SHANGHAI);
+    EXPECT_EQ(evmc::bytes32{entries[1].code_hash}, code_hash);
+    EXPECT_EQ(entries[1].counts[OP_PUSH1], 15);
+    EXPECT_EQ(entries[1].counts[OP_ADD], 5);
+    EXPECT_EQ(entries[1].counts[OP_MSTORE], 5);
+
+    evmone_histogram_reset();
+    EXPECT_EQ(evmone_histogram_snapshot(entries, std::size(entries)), 0);
+
+    execute(EVMC_LONDON, bytecode{OP_STOP}, 1);
+    ASSERT_EQ(evmone_histogram_snapshot(entries, 1), 1);
+    EXPECT_EQ(entries[0].counts[OP_STOP], 1);
+    EXPECT_EQ(entries[0].counts[OP_PUSH1], 0);
+}
+
+TEST(histogram, shared_vm)
+{
+    const auto code = push(1) + push(2) + OP_ADD + push(0) + OP_MSTORE;
+
+    evmone_histogram_reset();
+
+    // A single VM executes on multiple threads at the same time.
+    evmc::VM vm{evmc_create_evmone()};
+    ASSERT_EQ(vm.set_option("histogram_collect", ""), EVMC_SET_OPTION_SUCCESS);
+    const auto run = [&vm, &code] {
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.gas = 1000000;
+        for (int i = 0; i < 1000; ++i)
+        {
+            EXPECT_EQ(
+                vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size()).status_code,
+                EVMC_SUCCESS);
+        }
+    };
+    std::thread t1{run};
+    std::thread t2{run};
+    t1.join();
+    t2.join();
+
+    evmone_histogram_entry entries[1]{};
+    ASSERT_EQ(evmone_histogram_snapshot(entries, std::size(entries)), 1);
+    EXPECT_EQ(entries[0].counts[OP_PUSH1], 6000);
+    EXPECT_EQ(entries[0].counts[OP_ADD], 2000);
+    EXPECT_EQ(entries[0].counts[OP_MSTORE], 2000);
+
+    evmone_histogram_reset();
+}
+
+TEST(histogram, json)
+{
+    std::vector<evmone_histogram_entry> entries(2);
+    entries[0].rev = EVMC_LONDON;
+    entries[0].code_hash.bytes[31] = 0x01;
+    entries[0].counts[OP_PUSH1] = 2;
+    entries[0].counts[OP_ADD] = 1;
+    entries[1].rev = EVMC_SHANGHAI;
+    entries[1].counts[0xef] = 3;
+
+    const auto hash0 = "0x" + std::string(62, '0') + "01";
+    const auto hash1 = "0x" + std::string(64, '0');
+    std::ostringstream out;
+    evmone::write_histogram_json(out, entries);
+    EXPECT_EQ(out.str(), "[\n{\"rev\":\"London\",\"code_hash\":\"" + hash0 +
+                             "\",\"counts\":{\"ADD\":1,\"PUSH1\":2}},\n"
+                             "{\"rev\":\"Shanghai\",\"code_hash\":\"" +
+                             hash1 + "\",\"counts\":{\"0xef\":3}}\n]\n");
+
+    out.str({});
+    evmone::write_histogram_json(out, {});
+    EXPECT_EQ(out.str(), "[\n]\n");
+}
@@ -0,0 +1,109 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "test/utils/bytecode.hpp"
+#include <evmc/evmc.hpp>
+#include <evmc/mocked_host.hpp>
+#include <evmone/evmone.h>
+#include <evmone/keccak_cache.hpp>
+#include <evmone/vm.hpp>
+#include <gtest/gtest.h>
+#include <cstring>
+
+using namespace evmc::literals;
+using evmone::KeccakCache;
+
+namespace
+{
+constexpr auto keccak_empty =
+    0xc5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470_bytes32;
+constexpr auto keccak_zeros32 =
+    0x290decd9548b62a8d60345a988386fc84ba6bc95484008f6362f93160ef3e563_bytes32;
+constexpr auto keccak_zeros64 =
+    0xad3228b676f7d3cd4284a5443f17f1962b36e491b30a40b2405849e597ba5fb5_bytes32;
+}  // namespace
+
+TEST(keccak_cache, hash)
+{
+    const uint8_t zeros[KeccakCache::max_input_size]{};
+    KeccakCache cache;
+    EXPECT_EQ(cache.hash(nullptr, 0), keccak_empty);
+    EXPECT_EQ(cache.hash(zeros, 32), keccak_zeros32);
+    EXPECT_EQ(cache.hash(zeros, 64), keccak_zeros64);
+    EXPECT_EQ(cache.hits(), 0);
+    EXPECT_EQ(cache.misses(), 3);
+
+    EXPECT_EQ(cache.hash(zeros, 64), keccak_zeros64);
+    EXPECT_EQ(cache.hash(zeros, 32), keccak_zeros32);
+    EXPECT_EQ(cache.hash(nullptr, 0), keccak_empty);
+    EXPECT_EQ(cache.hits(), 3);
+    EXPECT_EQ(cache.misses(), 3);
+}
+
+TEST(keccak_cache, different_inputs)
+{
+    uint8_t input[KeccakCache::max_input_size]{};
+    KeccakCache cache;
+    const auto h0 = cache.hash(input, sizeof(input));
+    input[63] = 1;
+    const auto h1 = cache.hash(input, sizeof(input));
+    EXPECT_NE(h1, h0);
+    input[63] = 0;
+    EXPECT_EQ(cache.hash(input, sizeof(input)), h0);
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_EQ(cache.misses(), 2);
+}
+
+TEST(keccak_cache, clear)
+{
+    const uint8_t zeros[KeccakCache::max_input_size]{};
+    KeccakCache cache;
+    EXPECT_EQ(cache.hash(zeros, 64), keccak_zeros64);
+    cache.clear();
+    EXPECT_EQ(cache.hash(zeros, 64), keccak_zeros64);
+    EXPECT_EQ(cache.hits(), 0);
+    EXPECT_EQ(cache.misses(), 2);
+}
+
+TEST(keccak_cache, execution)
+{
+    // Derive the same "mapping slot" twice and return the sum of both hashes.
+    const auto code = keccak256(0, 64) + keccak256(0, 64) + OP_ADD + ret_top();
+    constexpr auto expected =
+        0x5a64516cedefa79a85094a887e2fe32c566dc9236614816480b093cb2f74bf6a_bytes32;
+
+    for (const auto advanced : {false, true})
+    {
+        evmc::VM vm{evmc_create_evmone()};
+        ASSERT_EQ(vm.set_option("keccak_cache", ""), EVMC_SET_OPTION_SUCCESS);
+        if (advanced)
+        {
+            ASSERT_EQ(vm.set_option("advanced", ""), EVMC_SET_OPTION_SUCCESS);
+        }
+        const auto& cache = *static_cast<evmone::VM*>(vm.get_raw_pointer())->get_keccak_cache();
+
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.gas = 1000000;
+        const auto r1 = vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size());
+        ASSERT_EQ(r1.status_code, EVMC_SUCCESS);
+        ASSERT_EQ(r1.output_size, sizeof(expected));
+        EXPECT_EQ(0, std::memcmp(r1.output_data, expected.bytes, sizeof(expected)));
+        EXPECT_EQ(cache.hits(), 1);
+        EXPECT_EQ(cache.misses(), 1);
+
+        // The cache is cleared at the start of the next transaction (depth 0).
+        const auto r2 = vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size());
+        ASSERT_EQ(r2.status_code, EVMC_SUCCESS);
+        EXPECT_EQ(cache.hits(), 2);
+        EXPECT_EQ(cache.misses(), 2);
+
+        // Nested calls share the cache of the transaction.
+        msg.depth = 1;
+        const auto r3 = vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size());
+        ASSERT_EQ(r3.status_code, EVMC_SUCCESS);
+        EXPECT_EQ(cache.hits(), 4);
+        EXPECT_EQ(cache.misses(), 2);
+    }
+}
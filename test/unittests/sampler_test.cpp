@@ -0,0 +1,130 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "test/utils/bytecode.hpp"
+#include <evmc/evmc.hpp>
+#include <evmc/mocked_host.hpp>
+#include <evmone/evmone.h>
+#include <evmone/sampler.hpp>
+#include <evmone/vm.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+
+using evmone::Sample;
+using evmone::Sampler;
+
+TEST(sampler, tick)
+{
+    Sampler sampler{3};
+    EXPECT_EQ(sampler.period(), 3);
+    EXPECT_FALSE(sampler.tick());
+    EXPECT_FALSE(sampler.tick());
+    EXPECT_TRUE(sampler.tick());
+    EXPECT_FALSE(sampler.tick());
+    EXPECT_FALSE(sampler.tick());
+    EXPECT_TRUE(sampler.tick());
+}
+
+TEST(sampler, ring_buffer)
+{
+    Sampler sampler;
+    EXPECT_EQ(sampler.period(), Sampler::default_period);
+    EXPECT_TRUE(sampler.samples().empty());
+
+    for (uint32_t i = 0; i < Sampler::capacity + 2; ++i)
+        sampler.record({{}, i, 0, 0});
+    EXPECT_EQ(sampler.num_samples(), Sampler::capacity + 2);
+
+    // The 2 oldest samples have been replaced.
+    const auto samples = sampler.samples();
+    ASSERT_EQ(samples.size(), Sampler::capacity);
+    EXPECT_EQ(samples.front().pc, 2);
+    EXPECT_EQ(samples.back().pc, Sampler::capacity + 1);
+
+    sampler.clear();
+    EXPECT_EQ(sampler.num_samples(), 0);
+    EXPECT_TRUE(sampler.samples().empty());
+}
+
+TEST(sampler, execution)
+{
+    const auto code = push(1) + push(2) + OP_ADD + push(0) + OP_MSTORE + OP_STOP;
+
+    evmc::VM vm{evmc_create_evmone()};
+    ASSERT_EQ(vm.set_option("sampling", "4"), EVMC_SET_OPTION_SUCCESS);
+    const auto& sampler = *static_cast<evmone::VM*>(vm.get_raw_pointer())->get_sampler();
+
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.depth = 1;
+    msg.gas = 1000000;
+    const auto r = vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size());
+    ASSERT_EQ(r.status_code, EVMC_SUCCESS);
+
+    // The 4th of the 6 instructions is sampled.
+    auto samples = sampler.samples();
+    ASSERT_EQ(samples.size(), 1);
+    EXPECT_EQ(samples[0].pc, 5);
+    EXPECT_EQ(samples[0].opcode, OP_PUSH1);
+    EXPECT_EQ(samples[0].depth, 1);
+    EXPECT_NE(samples[0].code_hash, evmc::bytes32{});
+
+    // The countdown continues in the next execution.
+    const auto r2 = vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size());
+    ASSERT_EQ(r2.status_code, EVMC_SUCCESS);
+    samples = sampler.samples();
+    ASSERT_EQ(samples.size(), 3);
+    EXPECT_EQ(samples[1].pc, 2);
+    EXPECT_EQ(samples[1].opcode, OP_PUSH1);
+    EXPECT_EQ(samples[2].pc, 8);
+    EXPECT_EQ(samples[2].opcode, OP_STOP);
+    EXPECT_EQ(samples[1].code_hash, samples[0].code_hash);
+    EXPECT_EQ(samples[2].code_hash, samples[0].code_hash);
+}
+
+TEST(sampler, eof_execution)
+{
+    const auto code = eof1_bytecode(push(1) + OP_POP + OP_STOP, 1);
+
+    evmc::VM vm{evmc_create_evmone()};
+    ASSERT_EQ(vm.set_option("sampling", "1"), EVMC_SET_OPTION_SUCCESS);
+    const auto& sampler = *static_cast<evmone::VM*>(vm.get_raw_pointer())->get_sampler();
+
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000000;
+    const auto r = vm.execute(host, EVMC_CANCUN, msg, code.data(), code.size());
+    ASSERT_EQ(r.status_code, EVMC_SUCCESS);
+
+    // The pc is the offset in the container, which the code hash is computed from.
+    const auto samples = sampler.samples();
+    ASSERT_EQ(samples.size(), 3);
+    EXPECT_EQ(samples[0].opcode, OP_PUSH1);
+    EXPECT_EQ(samples[1].opcode, OP_POP);
+    EXPECT_EQ(samples[2].opcode, OP_STOP);
+    for (const auto& sample : samples)
+    {
+        ASSERT_LT(sample.pc, code.size());
+        EXPECT_EQ(code[sample.pc], sample.opcode);
+    }
+    EXPECT_EQ(samples[1].pc, samples[0].pc + 2);
+}
+
+TEST(sampler, disabled_by_tracer)
+{
+    const auto code = push(1) + push(2) + OP_ADD;
+
+    evmc::VM vm{evmc_create_evmone()};
+    ASSERT_EQ(vm.set_option("sampling", "1"), EVMC_SET_OPTION_SUCCESS);
+    auto& evmone_vm = *static_cast<evmone::VM*>(vm.get_raw_pointer());
+    std::ostringstream histogram;
+    evmone_vm.add_tracer(evmone::create_histogram_tracer(histogram));
+
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000000;
+    const auto r = vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size());
+    ASSERT_EQ(r.status_code, EVMC_SUCCESS);
+    EXPECT_EQ(evmone_vm.get_sampler()->num_samples(), 0);
+}
@@ -0,0 +1,133 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "test/state/host_recording.hpp"
+#include "test/utils/bytecode.hpp"
+#include <evmc/evmc.hpp>
+#include <evmc/mocked_host.hpp>
+#include <evmone/evmone.h>
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace evmc::literals;
+using namespace evmone::state;
+
+namespace
+{
+// Stores the call output and the block number, and returns the storage value and the balance.
+const auto code = call(0xca11).gas(0xffff).input(0, 4).output(0, 32) + OP_POP +
+                  sstore(1, push(0) + OP_MLOAD) + sstore(2, OP_NUMBER) + push(0) + push(0) +
+                  OP_LOG0 + mstore(0, sload(1)) + mstore(32, push(0xba1) + OP_BALANCE) +
+                  ret(0, 64);
+
+const uint8_t call_output[32]{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0xca, 0x11};
+
+HostRecording record(evmc::MockedHost& host, const evmc_message& msg)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    HostRecording recording{EVMC_SHANGHAI, msg, code};
+    RecordingHost recording_host{host, recording};
+    const auto r = vm.execute(recording_host, EVMC_SHANGHAI, msg, code.data(), code.size());
+    EXPECT_EQ(r.status_code, EVMC_SUCCESS);
+    EXPECT_EQ(host.recorded_calls.size(), 1);
+    return recording;
+}
+}  // namespace
+
+TEST(state_host_recording, record_and_replay)
+{
+    evmc::MockedHost host;
+    host.tx_context.block_number = 42;
+    host.call_result.output_data = call_output;
+    host.call_result.output_size = sizeof(call_output);
+    host.call_result.gas_left = 1;
+
+    const uint8_t input[]{1, 2, 3};
+    evmc_message msg{};
+    msg.gas = 1000000;
+    msg.recipient = 0xc0de_address;
+    msg.input_data = input;
+    msg.input_size = sizeof(input);
+
+    // The expected result comes from the identical host as the recording one
+    // because the host state (e.g. the storage access status) affects the execution.
+    auto expected_host = host;
+    evmc::VM vm{evmc_create_evmone()};
+    const auto expected = vm.execute(expected_host, EVMC_SHANGHAI, msg, code.data(), code.size());
+    ASSERT_EQ(expected.status_code, EVMC_SUCCESS);
+    const auto expected_output = evmc::bytes_view{expected.output_data, expected.output_size};
+
+    std::stringstream file;
+    record(host, msg).save(file);
+    const auto recording = HostRecording::load(file);
+    ASSERT_TRUE(recording.has_value());
+    EXPECT_EQ(recording->rev, EVMC_SHANGHAI);
+    EXPECT_EQ(recording->code, evmc::bytes{code});
+    EXPECT_EQ(recording->msg.gas, msg.gas);
+    EXPECT_EQ(evmc::address{recording->msg.recipient}, msg.recipient);
+    EXPECT_EQ((evmc::bytes_view{recording->msg.input_data, recording->msg.input_size}),
+        (evmc::bytes_view{input, sizeof(input)}));
+
+    // Replay twice to check the rewind.
+    ReplayHost replay_host{*recording};
+    for (int i = 0; i < 2; ++i)
+    {
+        replay_host.rewind();
+        const auto r = vm.execute(
+            replay_host, recording->rev, recording->msg, code.data(), code.size());
+        EXPECT_FALSE(replay_host.diverged());
+        EXPECT_EQ(r.status_code, EVMC_SUCCESS);
+        EXPECT_EQ(r.gas_left, expected.gas_left);
+        EXPECT_EQ((evmc::bytes_view{r.output_data, r.output_size}), expected_output);
+    }
+}
+
+TEST(state_host_recording, replay_divergence)
+{
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000000;
+    const auto recording = record(host, msg);
+
+    evmc::VM vm{evmc_create_evmone()};
+    ReplayHost replay_host{recording};
+
+    // Different code makes different host calls.
+    const auto other_code = sstore(1, 1);
+    vm.execute(replay_host, recording.rev, recording.msg, other_code.data(), other_code.size());
+    EXPECT_TRUE(replay_host.diverged());
+
+    // Only the prefix of the recorded host calls is made.
+    replay_host.rewind();
+    const bytecode prefix_code = call(0xca11).gas(0xffff).input(0, 4).output(0, 32);
+    vm.execute(replay_host, recording.rev, recording.msg, prefix_code.data(), prefix_code.size());
+    EXPECT_TRUE(replay_host.diverged());
+
+    replay_host.rewind();
+    vm.execute(replay_host, recording.rev, recording.msg, code.data(), code.size());
+    EXPECT_FALSE(replay_host.diverged());
+}
+
+TEST(state_host_recording, load_invalid)
+{
+    std::stringstream empty;
+    EXPECT_FALSE(HostRecording::load(empty).has_value());
+
+    std::stringstream bad_magic{"EVMTRACE"};
+    EXPECT_FALSE(HostRecording::load(bad_magic).has_value());
+
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000000;
+    std::stringstream file;
+    record(host, msg).save(file);
+    auto data = file.str();
+
+    std::stringstream truncated{data.substr(0, data.size() - 1)};
+    EXPECT_FALSE(HostRecording::load(truncated).has_value());
+
+    std::stringstream trailing{data + '\0'};
+    EXPECT_FALSE(HostRecording::load(trailing).has_value());
+}
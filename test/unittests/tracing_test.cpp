@@ -5,11 +5,14 @@
 #include "test/utils/bytecode.hpp"
 #include <evmc/evmc.hpp>
 #include <evmc/mocked_host.hpp>
+#include <evmone/binary_trace.hpp>
 #include <evmone/evmone.h>
 #include <evmone/instructions_traits.hpp>
 #include <evmone/tracing.hpp>
 #include <evmone/vm.hpp>
 #include <gmock/gmock.h>
+#include <filesystem>
+#include <fstream>
 
 using namespace testing;
 
@@ -92,6 +95,35 @@ protected:
 
         [[nodiscard]] const bytes& get_last_code() const noexcept { return m_last_code; }
     };
+
+    /// The tracer of the execution start and end only.
+    class FrameTracer final : public evmone::Tracer
+    {
+        std::ostringstream& m_trace;
+
+        [[nodiscard]] bool traces_instructions() const noexcept override { return false; }
+
+        void on_execution_start(
+            evmc_revision /*rev*/, const evmc_message& msg, bytes_view /*code*/) noexcept override
+        {
+            m_trace << "start:" << msg.depth << " ";
+        }
+
+        void on_execution_end(const evmc_result& result) noexcept override
+        {
+            m_trace << "end:" << result.status_code << " ";
+        }
+
+        void on_instruction_start(uint32_t /*pc*/, const intx::uint256* /*stack_top*/,
+            int /*stack_height*/, int64_t /*gas*/,
+            const evmone::ExecutionState& /*state*/) noexcept override
+        {
+            m_trace << "instruction ";
+        }
+
+    public:
+        explicit FrameTracer(tracing& parent) noexcept : m_trace{parent.trace_stream} {}
+    };
 };
 
 
@@ -124,6 +156,24 @@ TEST_F(tracing, three_tracers)
     EXPECT_EQ(trace(dup1(0)), "A0:PUSH1 B0:PUSH1 C0:PUSH1 A2:DUP1 B2:DUP1 C2:DUP1 ");
 }
 
+TEST_F(tracing, frame_tracer)
+{
+    vm.add_tracer(std::make_unique<FrameTracer>(*this));
+    EXPECT_FALSE(vm.get_tracer()->wants_instructions());
+
+    EXPECT_EQ(trace(add(1, 2)), "start:0 end:0 ");
+}
+
+TEST_F(tracing, frame_and_instruction_tracers)
+{
+    vm.add_tracer(std::make_unique<FrameTracer>(*this));
+    vm.add_tracer(std::make_unique<OpcodeTracer>(*this, "A"));
+    EXPECT_TRUE(vm.get_tracer()->wants_instructions());
+
+    EXPECT_EQ(trace(add(1, 2)),
+        "start:0 instruction A0:PUSH1 instruction A2:PUSH1 instruction A4:ADD end:0 ");
+}
+
 TEST_F(tracing, histogram)
 {
     vm.add_tracer(evmone::create_histogram_tracer(trace_stream));
@@ -163,6 +213,32 @@ SWAP1,1
 )");
 }
 
+TEST_F(tracing, cycles)
+{
+    auto& cycle_tracer = vm.enable_cycle_tracer();
+    EXPECT_EQ(&vm.enable_cycle_tracer(), &cycle_tracer);
+    EXPECT_EQ(vm.get_cycle_tracer(), &cycle_tracer);
+
+    const auto code = push(1) + push(2) + OP_ADD + push(0) + OP_MSTORE;
+    trace(code);
+    trace(code, 0, 0, EVMC_LONDON);
+    trace(code, 0, 0, EVMC_LONDON);
+
+    std::ostringstream report;
+    cycle_tracer.report(report);
+    EXPECT_THAT(report.str(), StartsWith("rev,opcode,count,total,mean,p99\n"));
+    EXPECT_THAT(report.str(), HasSubstr("\nBerlin,PUSH1,3,"));
+    EXPECT_THAT(report.str(), HasSubstr("\nBerlin,ADD,1,"));
+    EXPECT_THAT(report.str(), HasSubstr("\nBerlin,MSTORE,1,"));
+    EXPECT_THAT(report.str(), HasSubstr("\nLondon,PUSH1,6,"));
+    EXPECT_THAT(report.str(), HasSubstr("\nLondon,ADD,2,"));
+
+    cycle_tracer.reset();
+    report.str({});
+    cycle_tracer.report(report);
+    EXPECT_EQ(report.str(), "rev,opcode,count,total,mean,p99\n");
+}
+
 TEST_F(tracing, trace)
 {
     vm.add_tracer(evmone::create_instruction_tracer(trace_stream));
@@ -308,3 +384,143 @@ TEST_F(tracing, trace_eof)
 {"error":null,"gas":0xf4237,"gasUsed":0x9,"output":""}
 )");
 }
+
+TEST(binary_tracing, records)
+{
+    using namespace evmone::binary_trace;
+    const auto path = std::filesystem::temp_directory_path() / "evmone_binary_tracing_test.bin";
+
+    {
+        evmc::VM vm{evmc_create_evmone()};
+        EXPECT_EQ(vm.set_option("binary_trace", ""), EVMC_SET_OPTION_INVALID_VALUE);
+        ASSERT_EQ(vm.set_option("binary_trace", path.string().c_str()), EVMC_SET_OPTION_SUCCESS);
+
+        // Returns 160 bytes of memory to produce 2 output records.
+        const auto code = push(1) + push(2) + push(3) + push(4) + push(5) + OP_ADD + OP_MSTORE +
+                          ret(0, 160);
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.depth = 1;
+        msg.flags = EVMC_STATIC;
+        msg.gas = 1000000;
+        const auto r = vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+        ASSERT_EQ(r.status_code, EVMC_SUCCESS);
+    }  // The trace file is complete when the VM and its tracers are destroyed.
+
+    std::ifstream in{path, std::ios::binary};
+    FileHeader header{};
+    ASSERT_TRUE(in.read(reinterpret_cast<char*>(&header), sizeof(header)));
+    EXPECT_EQ(header.version, FileHeader::expected_version);
+    EXPECT_EQ(header.record_size, sizeof(Record));
+
+    std::vector<Record> records;
+    for (Record rec{}; in.read(reinterpret_cast<char*>(&rec), sizeof(rec));)
+        records.push_back(rec);
+    in.close();
+    std::filesystem::remove(path);
+
+    // start + 10 instructions + end + 2 output records.
+    ASSERT_EQ(records.size(), 14);
+
+    EXPECT_EQ(records[0].kind, RecordKind::execution_start);
+    EXPECT_EQ(records[0].value, 1);
+    EXPECT_EQ(records[0].is_static, 1);
+    EXPECT_EQ(records[0].pc, static_cast<uint32_t>(EVMC_BERLIN));
+    EXPECT_EQ(records[0].gas, 1000000);
+
+    // The ADD: the top 4 of 5 stack items are recorded, the top first.
+    const auto& add = records[6];
+    EXPECT_EQ(add.kind, RecordKind::instruction);
+    EXPECT_EQ(add.opcode, OP_ADD);
+    EXPECT_EQ(add.pc, 10);
+    EXPECT_EQ(add.value, 5);
+    EXPECT_EQ(add.data_size, max_stack_items);
+    EXPECT_EQ(add.gas, 1000000 - 5 * 3);
+    EXPECT_EQ(add.size, 0);
+    for (size_t i = 0; i < max_stack_items; ++i)
+    {
+        EXPECT_EQ(add.data[i][0], 5 - i);
+        EXPECT_EQ(add.data[i][1], 0);
+    }
+
+    const auto& end = records[11];
+    EXPECT_EQ(end.kind, RecordKind::execution_end);
+    EXPECT_EQ(end.value, static_cast<int32_t>(EVMC_SUCCESS));
+    EXPECT_EQ(end.size, 160);
+    EXPECT_EQ(records[12].kind, RecordKind::output);
+    EXPECT_EQ(records[12].data_size, max_output_chunk_size);
+    EXPECT_EQ(records[13].kind, RecordKind::output);
+    EXPECT_EQ(records[13].data_size, 160 - max_output_chunk_size);
+}
+
+TEST(profile_tracing, folded_stacks)
+{
+    using namespace evmc::literals;
+    using namespace std::string_literals;
+    const auto path = std::filesystem::temp_directory_path() / "evmone_profile_tracing_test";
+    const auto gas_path = path.string() + ".gas.folded";
+    const auto time_path = path.string() + ".time.folded";
+
+    {
+        evmc::VM vm{evmc_create_evmone()};
+        EXPECT_EQ(vm.set_option("profile", ""), EVMC_SET_OPTION_INVALID_VALUE);
+        EXPECT_EQ(vm.set_option("profile", path.string().c_str()), EVMC_SET_OPTION_SUCCESS);
+    }
+
+    {
+        const auto tracer = evmone::create_profile_tracer(path.string().c_str());
+        ASSERT_NE(tracer, nullptr);
+
+        evmc_message tx{};
+        tx.code_address = 0xaa_address;
+        tx.gas = 1000;
+        evmc_message call{};
+        call.kind = EVMC_DELEGATECALL;
+        call.depth = 1;
+        call.code_address = 0xbb_address;
+        call.gas = 500;
+        evmc_message create{};
+        create.kind = EVMC_CREATE;
+        create.depth = 1;
+        create.recipient = 0xcc_address;
+        create.gas = 200;
+
+        const auto result = [](evmc_status_code status, int64_t gas_left) {
+            evmc_result r{};
+            r.status_code = status;
+            r.gas_left = gas_left;
+            return r;
+        };
+
+        // The transaction uses 600 gas of which 300 are used by the nested call
+        // and 100 by the nested create.
+        tracer->notify_execution_start(EVMC_CANCUN, tx, {});
+        tracer->notify_execution_start(EVMC_CANCUN, call, {});
+        tracer->notify_execution_end(result(EVMC_SUCCESS, 200));
+        tracer->notify_execution_start(EVMC_CANCUN, create, {});
+        tracer->notify_execution_end(result(EVMC_REVERT, 100));
+        tracer->notify_execution_end(result(EVMC_SUCCESS, 400));
+    }  // The files are closed when the tracer is destroyed.
+
+    std::ifstream gas_file{gas_path};
+    const std::string gas_profile{std::istreambuf_iterator<char>{gas_file}, {}};
+    gas_file.close();
+    std::ifstream time_file{time_path};
+    std::vector<std::string> time_lines;
+    for (std::string line; std::getline(time_file, line);)
+        time_lines.push_back(line);
+    time_file.close();
+    std::filesystem::remove(gas_path);
+    std::filesystem::remove(time_path);
+
+    const auto tx_frame = "CALL:0x00000000000000000000000000000000000000aa"s;
+    const auto call_frame = ";DELEGATECALL:0x00000000000000000000000000000000000000bb"s;
+    const auto create_frame = ";CREATE:0x00000000000000000000000000000000000000cc"s;
+    EXPECT_EQ(gas_profile, tx_frame + " 200\n" + tx_frame + create_frame + " 100\n" + tx_frame +
+                               call_frame + " 300\n");
+
+    ASSERT_EQ(time_lines.size(), 3);
+    EXPECT_THAT(time_lines[0], StartsWith(tx_frame + " "));
+    EXPECT_THAT(time_lines[1], StartsWith(tx_frame + create_frame + " "));
+    EXPECT_THAT(time_lines[2], StartsWith(tx_frame + call_frame + " "));
+}